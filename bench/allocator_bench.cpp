@@ -0,0 +1,120 @@
+#include "util/arena.h"
+#include "util/memory.h"
+#include <benchmark/benchmark.h>
+#include <cstdlib>
+#include <memory_resource>
+
+namespace
+{
+constexpr std::size_t resource_size = 4096;
+
+void BM_resource_allocator_alloc_objects(benchmark::State &state)
+{
+	const uint32_t amount = state.range(0);
+	std::vector<memory::region> regions;
+	regions.reserve(amount);
+
+	for (auto _ : state)
+	{
+		memory::resource_allocator allocator;
+		allocator.alloc_objects(resource_size, amount, regions);
+		benchmark::DoNotOptimize(regions.data());
+		regions.clear();
+	}
+
+	state.SetItemsProcessed(state.iterations() * amount);
+}
+BENCHMARK(BM_resource_allocator_alloc_objects)->Arg(1)->Arg(16)->Arg(256);
+
+void BM_resource_allocator_alloc_objects_aligned(benchmark::State &state)
+{
+	const uint32_t amount = state.range(0);
+	std::vector<memory::region> regions;
+	regions.reserve(amount);
+
+	for (auto _ : state)
+	{
+		memory::resource_allocator allocator(memory::resource_options{memory::page_size});
+		allocator.alloc_objects(resource_size, amount, regions);
+		benchmark::DoNotOptimize(regions.data());
+		regions.clear();
+	}
+
+	state.SetItemsProcessed(state.iterations() * amount);
+}
+BENCHMARK(BM_resource_allocator_alloc_objects_aligned)->Arg(16)->Arg(256);
+
+void BM_new_array_batch(benchmark::State &state)
+{
+	std::vector<uint8_t *> blocks(state.range(0));
+
+	for (auto _ : state)
+	{
+		for (uint8_t *&block : blocks)
+			block = new uint8_t[resource_size];
+		benchmark::DoNotOptimize(blocks.data());
+		for (uint8_t *block : blocks)
+			delete[] block;
+	}
+
+	state.SetItemsProcessed(state.iterations() * blocks.size());
+}
+BENCHMARK(BM_new_array_batch)->Arg(1)->Arg(16)->Arg(256);
+
+void BM_pmr_monotonic_batch(benchmark::State &state)
+{
+	const std::size_t amount = state.range(0);
+
+	for (auto _ : state)
+	{
+		std::pmr::monotonic_buffer_resource resource;
+		for (std::size_t i = 0; i < amount; ++i)
+			benchmark::DoNotOptimize(resource.allocate(resource_size));
+	}
+
+	state.SetItemsProcessed(state.iterations() * amount);
+}
+BENCHMARK(BM_pmr_monotonic_batch)->Arg(1)->Arg(16)->Arg(256);
+
+// Bump allocators never free, so both are rewound once they've handed out scratch_size bytes
+constexpr std::size_t scratch_size = 4 << 20;
+
+void BM_arena_allocate(benchmark::State &state)
+{
+	const std::size_t objectSize = state.range(0);
+	const std::size_t resetInterval = scratch_size / objectSize;
+	memory::resource_pool pool(1 << 20, 4);
+	memory::arena<> scratch(pool);
+	std::size_t allocations = 0;
+
+	for (auto _ : state)
+	{
+		if (++allocations == resetInterval)
+		{
+			scratch.reset();
+			allocations = 0;
+		}
+		benchmark::DoNotOptimize(scratch.allocate(objectSize));
+	}
+}
+BENCHMARK(BM_arena_allocate)->Arg(16)->Arg(256);
+
+void BM_pmr_monotonic_allocate(benchmark::State &state)
+{
+	const std::size_t objectSize = state.range(0);
+	const std::size_t resetInterval = scratch_size / objectSize;
+	std::pmr::monotonic_buffer_resource resource;
+	std::size_t allocations = 0;
+
+	for (auto _ : state)
+	{
+		if (++allocations == resetInterval)
+		{
+			resource.release();
+			allocations = 0;
+		}
+		benchmark::DoNotOptimize(resource.allocate(objectSize));
+	}
+}
+BENCHMARK(BM_pmr_monotonic_allocate)->Arg(16)->Arg(256);
+} // namespace
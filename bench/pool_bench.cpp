@@ -0,0 +1,185 @@
+#include "util/concurrent_pool.h"
+#include "util/memory.h"
+#include "util/object_pool.h"
+#include <benchmark/benchmark.h>
+#include <cstdlib>
+#include <memory_resource>
+#include <mutex>
+
+namespace
+{
+constexpr std::size_t region_size = 4096;
+
+void BM_malloc_free(benchmark::State &state)
+{
+	for (auto _ : state)
+	{
+		void *ptr = malloc(region_size);
+		benchmark::DoNotOptimize(ptr);
+		free(ptr);
+	}
+}
+BENCHMARK(BM_malloc_free);
+
+void BM_pmr_pool_allocate_deallocate(benchmark::State &state)
+{
+	std::pmr::unsynchronized_pool_resource resource;
+
+	for (auto _ : state)
+	{
+		void *ptr = resource.allocate(region_size);
+		benchmark::DoNotOptimize(ptr);
+		resource.deallocate(ptr, region_size);
+	}
+}
+BENCHMARK(BM_pmr_pool_allocate_deallocate);
+
+void BM_resource_pool_acquire_release(benchmark::State &state)
+{
+	memory::resource_pool pool(region_size, 64);
+
+	for (auto _ : state)
+	{
+		memory::region target = pool.acquire();
+		benchmark::DoNotOptimize(target.startPtr);
+		pool.release(target);
+	}
+}
+BENCHMARK(BM_resource_pool_acquire_release);
+
+void BM_resource_pool_acquire_pooled(benchmark::State &state)
+{
+	memory::resource_pool pool(region_size, 64);
+
+	for (auto _ : state)
+	{
+		memory::pooled_region target = pool.acquire_pooled();
+		benchmark::DoNotOptimize(target.get().startPtr);
+	}
+}
+BENCHMARK(BM_resource_pool_acquire_pooled);
+
+void BM_malloc_free_batch(benchmark::State &state)
+{
+	std::vector<void *> ptrs(state.range(0));
+
+	for (auto _ : state)
+	{
+		for (void *&ptr : ptrs)
+			ptr = malloc(region_size);
+		benchmark::DoNotOptimize(ptrs.data());
+		for (void *ptr : ptrs)
+			free(ptr);
+	}
+
+	state.SetItemsProcessed(state.iterations() * ptrs.size());
+}
+BENCHMARK(BM_malloc_free_batch)->Arg(16)->Arg(256);
+
+void BM_resource_pool_bulk_acquire(benchmark::State &state)
+{
+	memory::resource_pool pool(region_size, state.range(0));
+	std::vector<memory::region> regions(state.range(0));
+
+	for (auto _ : state)
+	{
+		pool.acquire(std::span<memory::region>(regions));
+		benchmark::DoNotOptimize(regions.data());
+		pool.release(regions);
+	}
+
+	state.SetItemsProcessed(state.iterations() * regions.size());
+}
+BENCHMARK(BM_resource_pool_bulk_acquire)->Arg(16)->Arg(256);
+
+struct message
+{
+	uint64_t id;
+	uint32_t size;
+	uint32_t flags;
+};
+
+void BM_new_delete_object(benchmark::State &state)
+{
+	for (auto _ : state)
+	{
+		message *object = new message{1, 2, 3};
+		benchmark::DoNotOptimize(object);
+		delete object;
+	}
+}
+BENCHMARK(BM_new_delete_object);
+
+void BM_object_pool_create_destroy(benchmark::State &state)
+{
+	memory::object_pool<message> pool;
+
+	for (auto _ : state)
+	{
+		message *object = pool.create(1, 2, 3);
+		benchmark::DoNotOptimize(object);
+		pool.destroy(object);
+	}
+}
+BENCHMARK(BM_object_pool_create_destroy);
+
+// Multi threaded, every thread acquires and releases against the same pool
+
+void BM_malloc_free_threaded(benchmark::State &state)
+{
+	for (auto _ : state)
+	{
+		void *ptr = malloc(region_size);
+		benchmark::DoNotOptimize(ptr);
+		free(ptr);
+	}
+}
+BENCHMARK(BM_malloc_free_threaded)->ThreadRange(1, 8)->UseRealTime();
+
+void BM_pmr_synchronized_pool_threaded(benchmark::State &state)
+{
+	static std::pmr::synchronized_pool_resource resource;
+
+	for (auto _ : state)
+	{
+		void *ptr = resource.allocate(region_size);
+		benchmark::DoNotOptimize(ptr);
+		resource.deallocate(ptr, region_size);
+	}
+}
+BENCHMARK(BM_pmr_synchronized_pool_threaded)->ThreadRange(1, 8)->UseRealTime();
+
+void BM_locked_resource_pool_threaded(benchmark::State &state)
+{
+	static memory::resource_pool pool(region_size, 64);
+	static std::mutex poolMutex;
+
+	for (auto _ : state)
+	{
+		memory::region target;
+		{
+			std::lock_guard lock(poolMutex);
+			target = pool.acquire();
+		}
+		benchmark::DoNotOptimize(target.startPtr);
+		{
+			std::lock_guard lock(poolMutex);
+			pool.release(target);
+		}
+	}
+}
+BENCHMARK(BM_locked_resource_pool_threaded)->ThreadRange(1, 8)->UseRealTime();
+
+void BM_concurrent_resource_pool_threaded(benchmark::State &state)
+{
+	static memory::concurrent_resource_pool pool(region_size);
+
+	for (auto _ : state)
+	{
+		memory::region target = pool.acquire();
+		benchmark::DoNotOptimize(target.startPtr);
+		pool.release(target);
+	}
+}
+BENCHMARK(BM_concurrent_resource_pool_threaded)->ThreadRange(1, 8)->UseRealTime();
+} // namespace
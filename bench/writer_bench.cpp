@@ -0,0 +1,229 @@
+#include "util/checksum.h"
+#include "util/memory.h"
+#include <benchmark/benchmark.h>
+
+namespace
+{
+constexpr std::size_t buffer_size = 4 << 20;
+
+/*! @brief Source data for the writes, large enough for the biggest write size */
+const std::vector<uint8_t> &source_data()
+{
+	static const std::vector<uint8_t> data(buffer_size, 0x5A);
+	return data;
+}
+
+void BM_memcpy(benchmark::State &state)
+{
+	const std::size_t writeSize = state.range(0);
+	memory::resource buffer(buffer_size);
+	const uint8_t *src = source_data().data();
+	std::size_t offset = 0;
+
+	for (auto _ : state)
+	{
+		if (offset + writeSize > buffer_size)
+			offset = 0;
+
+		memcpy(buffer.get_pointer() + offset, src, writeSize);
+		offset += writeSize;
+		benchmark::ClobberMemory();
+	}
+
+	state.SetBytesProcessed(state.iterations() * writeSize);
+}
+BENCHMARK(BM_memcpy)->Arg(8)->Arg(64)->Arg(4 << 10)->Arg(64 << 10)->Arg(1 << 20);
+
+void BM_writer_write(benchmark::State &state)
+{
+	const std::size_t writeSize = state.range(0);
+	memory::resource buffer(buffer_size);
+	const uint8_t *src = source_data().data();
+	memory::writer output(buffer);
+
+	for (auto _ : state)
+	{
+		if (!output.write(src, writeSize))
+		{
+			output.reset();
+			output.write(src, writeSize);
+		}
+		benchmark::ClobberMemory();
+	}
+
+	state.SetBytesProcessed(state.iterations() * writeSize);
+}
+BENCHMARK(BM_writer_write)->Arg(8)->Arg(64)->Arg(4 << 10)->Arg(64 << 10)->Arg(1 << 20);
+
+void BM_crc32c_writer_write(benchmark::State &state)
+{
+	const std::size_t writeSize = state.range(0);
+	memory::resource buffer(buffer_size);
+	const uint8_t *src = source_data().data();
+	memory::crc32c_writer output(buffer);
+
+	for (auto _ : state)
+	{
+		if (!output.write(src, writeSize))
+		{
+			output.reset();
+			output.write(src, writeSize);
+		}
+		benchmark::ClobberMemory();
+	}
+
+	benchmark::DoNotOptimize(output.digest());
+	state.SetBytesProcessed(state.iterations() * writeSize);
+}
+BENCHMARK(BM_crc32c_writer_write)->Arg(64)->Arg(4 << 10)->Arg(64 << 10)->Arg(1 << 20);
+
+// Filling the whole buffer, then checksumming it in a second pass
+void BM_writer_fill_then_crc32c(benchmark::State &state)
+{
+	const std::size_t writeSize = state.range(0);
+	memory::resource buffer(buffer_size);
+	const uint8_t *src = source_data().data();
+	memory::writer output(buffer);
+
+	for (auto _ : state)
+	{
+		for (std::size_t written = 0; written + writeSize <= buffer_size; written += writeSize)
+			output.write(src, writeSize);
+		benchmark::DoNotOptimize(memory::crc32c(buffer.get_pointer(), output.bytes_written()));
+		output.reset();
+	}
+
+	state.SetBytesProcessed(state.iterations() * (buffer_size / writeSize) * writeSize);
+}
+BENCHMARK(BM_writer_fill_then_crc32c)->Arg(64)->Arg(4 << 10)->Arg(64 << 10)->Arg(1 << 20);
+
+void BM_writer_write_streaming(benchmark::State &state)
+{
+	const std::size_t writeSize = state.range(0);
+	memory::resource buffer(buffer_size);
+	const uint8_t *src = source_data().data();
+	memory::writer output(buffer);
+
+	for (auto _ : state)
+	{
+		if (!output.write_streaming(src, writeSize))
+		{
+			output.reset();
+			output.write_streaming(src, writeSize);
+		}
+		benchmark::ClobberMemory();
+	}
+
+	state.SetBytesProcessed(state.iterations() * writeSize);
+}
+BENCHMARK(BM_writer_write_streaming)->Arg(64 << 10)->Arg(1 << 20);
+
+void BM_unsafe_writer_write(benchmark::State &state)
+{
+	const std::size_t writeSize = state.range(0);
+	memory::resource buffer(buffer_size);
+	const uint8_t *src = source_data().data();
+	memory::unsafe::writer output = buffer;
+	std::size_t written = 0;
+
+	for (auto _ : state)
+	{
+		if (written + writeSize > buffer_size)
+		{
+			output = buffer;
+			written = 0;
+		}
+
+		output.write(src, writeSize);
+		written += writeSize;
+		benchmark::ClobberMemory();
+	}
+
+	state.SetBytesProcessed(state.iterations() * writeSize);
+}
+BENCHMARK(BM_unsafe_writer_write)->Arg(8)->Arg(64)->Arg(4 << 10)->Arg(64 << 10)->Arg(1 << 20);
+
+void BM_small_writer_write(benchmark::State &state)
+{
+	const std::size_t writeSize = state.range(0);
+	memory::resource buffer(buffer_size);
+	const uint8_t *src = source_data().data();
+	memory::small_writer output(buffer);
+
+	for (auto _ : state)
+	{
+		if (!output.write(src, writeSize))
+		{
+			output = memory::small_writer(buffer);
+			output.write(src, writeSize);
+		}
+		benchmark::ClobberMemory();
+	}
+
+	state.SetBytesProcessed(state.iterations() * writeSize);
+}
+BENCHMARK(BM_small_writer_write)->Arg(8)->Arg(64)->Arg(4 << 10);
+
+// Object writes have a compile time size, so these measure the bounds check against a direct store
+
+void BM_writer_write_object(benchmark::State &state)
+{
+	memory::resource buffer(buffer_size);
+	memory::writer output(buffer);
+	uint64_t value = 0;
+
+	for (auto _ : state)
+	{
+		if (!output.write(value))
+			output.reset();
+		++value;
+	}
+	benchmark::DoNotOptimize(buffer.get_pointer());
+
+	state.SetBytesProcessed(state.iterations() * sizeof(value));
+}
+BENCHMARK(BM_writer_write_object);
+
+void BM_unsafe_writer_write_object(benchmark::State &state)
+{
+	memory::resource buffer(buffer_size);
+	memory::unsafe::writer output = buffer;
+	std::size_t written = 0;
+	uint64_t value = 0;
+
+	for (auto _ : state)
+	{
+		if (written + sizeof(value) > buffer_size)
+		{
+			output = buffer;
+			written = 0;
+		}
+
+		output.write(value);
+		written += sizeof(value);
+		++value;
+	}
+	benchmark::DoNotOptimize(buffer.get_pointer());
+
+	state.SetBytesProcessed(state.iterations() * sizeof(value));
+}
+BENCHMARK(BM_unsafe_writer_write_object);
+
+void BM_writer_write_fields(benchmark::State &state)
+{
+	memory::resource buffer(buffer_size);
+	memory::writer output(buffer);
+	uint32_t id = 0;
+
+	for (auto _ : state)
+	{
+		if (!output.write_fields(id, uint16_t(1), uint64_t(2), 3.0f))
+			output.reset();
+		++id;
+	}
+	benchmark::DoNotOptimize(buffer.get_pointer());
+
+	state.SetBytesProcessed(state.iterations() * (sizeof(uint32_t) + sizeof(uint16_t) + sizeof(uint64_t) + sizeof(float)));
+}
+BENCHMARK(BM_writer_write_fields);
+} // namespace
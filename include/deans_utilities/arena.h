@@ -0,0 +1,200 @@
+#pragma once
+#include "util/memory.h"
+#include <memory_resource>
+#include <new>
+
+namespace memory
+{
+/**
+ * @brief A bump allocator over a chain of pooled regions
+ *
+ * Storage is handed out by a memory::writer over the current region, when it is full the next region in the chain
+ * is used, acquiring a new one from the pool if needed. Regions are kept on reset and returned to the pool on deconstruction
+ *
+ * @tparam PoolT Pool the regions are acquired from
+ *
+ * @warning Objects are never destroyed, only create trivially destructible objects or destroy them yourself
+ */
+template <typename PoolT = resource_pool>
+struct arena
+{
+	using size_type = std::size_t;
+
+	/**
+	 * @brief Constructor, does not acquire any region until the first allocation
+	 *
+	 * @param pool Pool to acquire regions from, must outlive the arena
+	 */
+	arena(PoolT &pool)
+		: pool(pool)
+	{
+	}
+
+	arena(const arena &) = delete;
+	arena &operator=(const arena &) = delete;
+
+	/*! @brief Deconstructor, releases all regions to the pool */
+	~arena()
+	{
+		for (const region &target : chain)
+			pool.release(target);
+	}
+
+	/**
+	 * @brief Allocate aligned storage
+	 *
+	 * @param size Size of the storage in bytes
+	 * @param alignment Alignment of the storage, a power of two
+	 * @return void* Start of the storage, or nullptr if it doesn't fit in a single pooled region, the chain is left as is
+	 */
+	void *allocate(size_type size, size_type alignment = alignof(std::max_align_t))
+	{
+		// Check the fit up front, so moving to the next region isn't counted as a failed write
+		if (!head.startPtr || padding(head.startPtr + head.bytes_written(), alignment) + size > head.bytes_remaining())
+		{
+			if (!fits_next_region(size, alignment))
+			{
+				detail::writer_counters::on_failure(size);
+				return nullptr;
+			}
+			advance();
+		}
+
+		return head.allocate(size, alignment);
+	}
+
+	/**
+	 * @brief Allocate uninitialized storage for an array of objects
+	 *
+	 * @tparam ObjectT Object type
+	 * @param count Number of objects
+	 * @return ObjectT* Start of the storage, or nullptr if it doesn't fit in a single pooled region
+	 */
+	template <typename ObjectT>
+	ObjectT *allocate(size_type count = 1)
+	{
+		return static_cast<ObjectT *>(allocate(sizeof(ObjectT) * count, alignof(ObjectT)));
+	}
+
+	/**
+	 * @brief Construct an object in the arena
+	 *
+	 * @tparam ObjectT Object type
+	 * @param args Constructor arguments
+	 * @return ObjectT* The constructed object, or nullptr if it doesn't fit in a single pooled region
+	 */
+	template <typename ObjectT, typename... ArgTs>
+	ObjectT *create(ArgTs &&...args)
+	{
+		void *storage = allocate(sizeof(ObjectT), alignof(ObjectT));
+		return storage ? new (storage) ObjectT(std::forward<ArgTs>(args)...) : nullptr;
+	}
+
+	/**
+	 * @brief Rewind the arena to the start of its first region, in constant time
+	 *
+	 * @warning Invalidates everything allocated from the arena
+	 */
+	void reset()
+	{
+		regionsUsed = 0;
+		head = writer();
+	}
+
+	/*! @brief Get the number of regions held by the arena */
+	size_type region_count() const
+	{
+		return chain.size();
+	}
+
+  private:
+	static size_type padding(const uint8_t *position, size_type alignment)
+	{
+		const std::size_t address = reinterpret_cast<std::size_t>(position);
+		return aligned_size(address, alignment) - address;
+	}
+
+	/*! @brief Get the alignment every pooled region starts at, pools that don't report their options only guarantee 1 */
+	size_type region_alignment() const
+	{
+		if constexpr (requires { pool.get_options(); })
+			return pool.get_options().alignment;
+		else
+			return 1;
+	}
+
+	/**
+	 * @brief Check if an allocation fits at the start of the next region, so oversized requests never grow the chain
+	 *
+	 * A region that still has to be acquired needs no padding up to the pool's alignment, larger alignments are checked against the worst case
+	 */
+	bool fits_next_region(size_type size, size_type alignment) const
+	{
+		// The region size is only known once the first region has been acquired
+		if (chain.empty())
+			return true;
+
+		if (regionsUsed < chain.size())
+			return padding(chain[regionsUsed].startPtr, alignment) + size <= chain[regionsUsed].size();
+
+		// Regions start aligned to the pool's alignment, so at most the difference has to be padded
+		const size_type worstPadding = alignment <= region_alignment() ? 0 : alignment - region_alignment();
+		return size + worstPadding <= chain.front().size();
+	}
+
+	/*! @brief Move the writer to the next region in the chain, acquiring it if needed */
+	void advance()
+	{
+		if (regionsUsed == chain.size())
+			chain.push_back(pool.acquire());
+
+		head = writer(chain[regionsUsed++]);
+	}
+
+	PoolT &pool;
+	std::vector<region> chain;
+	size_type regionsUsed = 0;
+	writer head;
+};
+
+/**
+ * @brief A std::pmr::memory_resource that allocates from an arena
+ *
+ * Deallocation does nothing, memory is reclaimed when the arena is reset
+ *
+ * @tparam PoolT Pool the arena acquires regions from
+ */
+template <typename PoolT = resource_pool>
+struct arena_memory_resource : public std::pmr::memory_resource
+{
+	/**
+	 * @brief Constructor
+	 *
+	 * @param target Arena to allocate from, must outlive this resource
+	 */
+	arena_memory_resource(arena<PoolT> &target)
+		: target(target)
+	{
+	}
+
+  private:
+	void *do_allocate(std::size_t bytes, std::size_t alignment) override
+	{
+		if (void *storage = target.allocate(bytes, alignment))
+			return storage;
+		throw std::bad_alloc();
+	}
+
+	void do_deallocate(void *, std::size_t, std::size_t) override
+	{
+	}
+
+	bool do_is_equal(const std::pmr::memory_resource &other) const noexcept override
+	{
+		return this == &other;
+	}
+
+	arena<PoolT> &target;
+};
+
+} // namespace memory
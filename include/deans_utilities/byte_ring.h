@@ -0,0 +1,385 @@
+#pragma once
+#include "util/memory.h"
+#include <atomic>
+#include <cerrno>
+#include <system_error>
+#include <thread>
+
+#if defined(__linux__) && defined(MEMORY_HAS_MMAN)
+#include <unistd.h>
+#define MEMORY_HAS_MIRRORED_MAPPING 1
+#endif
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#endif
+
+namespace memory
+{
+/**
+ * @brief Number of producers a byte ring supports
+ *
+ */
+enum class producer_mode : uint8_t
+{
+	/*! @brief One producer thread, reserve and commit never wait */
+	single,
+	/*! @brief Any number of producer threads, reservations are lock free and commits are published in reservation order */
+	multiple
+};
+
+/**
+ * @brief A lock free ring of variable sized records, passed from producer threads to one consumer thread
+ *
+ * Producers reserve a record, fill it through a writer and commit it. The consumer reads committed records
+ * in order and releases them in batches. Records never split across the end of the ring: an ordinary ring
+ * skips the remaining space, a mirrored ring maps its memory twice back to back so no space is skipped.
+ * Because of the skip an ordinary ring only guarantees records of up to half its capacity fit, see max_record_size
+ *
+ * @tparam Mode Number of producer threads
+ */
+template <producer_mode Mode>
+struct basic_byte_ring
+{
+	/*! @brief unsigned integer type*/
+	using size_type = std::size_t;
+
+	/*! @brief Size of the header in front of every record, records are aligned to this */
+	static constexpr size_type header_size = 8;
+
+	/**
+	 * @brief A reserved record
+	 *
+	 */
+	struct reservation
+	{
+		/*! @brief Writer over the record's payload */
+		memory::writer output;
+		uint64_t start = 0;
+		uint64_t end = 0;
+
+		/*! @brief Check if the reservation succeeded */
+		explicit operator bool() const
+		{
+			return end != 0;
+		}
+	};
+
+	/**
+	 * @brief Constructor
+	 *
+	 * @param capacity Size of the ring in bytes, a power of two, and a multiple of page_size when mirrored
+	 * @param mirrored Map the ring twice back to back, so records wrap without skipping space. Ignored where unsupported
+	 *
+	 * @throws std::system_error if the mirrored mapping cannot be created
+	 */
+	basic_byte_ring(size_type capacity, bool mirrored = false)
+		: capacity(capacity)
+	{
+		assert(std::has_single_bit(capacity) && "Byte ring capacity must be a power of two");
+
+#ifdef MEMORY_HAS_MIRRORED_MAPPING
+		if (mirrored)
+		{
+			data = map_mirrored(capacity);
+			return;
+		}
+#else
+		(void)mirrored;
+#endif
+		storage = resource(capacity, resource_options{cache_line_size});
+		data = storage.get_pointer();
+	}
+
+	basic_byte_ring(const basic_byte_ring &) = delete;
+	basic_byte_ring &operator=(const basic_byte_ring &) = delete;
+
+	/*! @brief Deconstructor, unmaps a mirrored ring */
+	~basic_byte_ring()
+	{
+#ifdef MEMORY_HAS_MIRRORED_MAPPING
+		if (!storage.get_pointer())
+			munmap(data, capacity * 2);
+#endif
+	}
+
+	/**
+	 * @brief Reserve a record, it is invisible to the consumer until committed
+	 *
+	 * @param size Size of the record's payload in bytes, no larger than max_record_size()
+	 * @return reservation The reserved record, false if the ring is out of space and nothing was reserved
+	 */
+	reservation reserve(size_type size)
+	{
+		assert(size <= max_record_size() && "Record is larger than the ring can always fit");
+		const size_type total = aligned_size(header_size + size, header_size);
+
+		uint64_t start;
+		uint64_t recordStart;
+		uint64_t end;
+
+		if constexpr (Mode == producer_mode::single)
+		{
+			start = producer.tail;
+			place(start, total, recordStart, end);
+
+			// The consumer's head is only reloaded when the cached copy says the ring is full
+			if (end - producer.cachedHead > capacity)
+			{
+				producer.cachedHead = consumerHead.value.load(std::memory_order_acquire);
+				if (end - producer.cachedHead > capacity)
+					return {};
+			}
+
+			producer.tail = end;
+		}
+		else
+		{
+			start = producer.tail.load(std::memory_order_relaxed);
+			do
+			{
+				place(start, total, recordStart, end);
+				if (end - consumerHead.value.load(std::memory_order_acquire) > capacity)
+					return {};
+			} while (!producer.tail.compare_exchange_weak(start, end, std::memory_order_relaxed));
+		}
+
+		if (recordStart != start)
+			write_header(start, uint32_t(recordStart - start), padding_flag);
+		write_header(recordStart, uint32_t(size), 0);
+
+		return reservation{memory::writer(region(data + offset(recordStart) + header_size, size)), start, end};
+	}
+
+	/**
+	 * @brief Publish a reserved record to the consumer
+	 *
+	 * With a single producer committing a record also commits every earlier reservation, so a batch can be committed at once.
+	 * With multiple producers every reservation must be committed, commits wait for earlier reservations to be committed
+	 *
+	 * @param record Reservation to commit
+	 */
+	void commit(const reservation &record)
+	{
+		if constexpr (Mode == producer_mode::multiple)
+		{
+			// Spin briefly, then yield in case the earlier producer was preempted
+			for (uint32_t spins = 0; published.value.load(std::memory_order_acquire) != record.start; ++spins)
+			{
+				if (spins < 64)
+					pause();
+				else
+					std::this_thread::yield();
+			}
+		}
+
+		published.value.store(record.end, std::memory_order_release);
+	}
+
+	/**
+	 * @brief Write a whole record
+	 *
+	 * @param src Pointer to the record
+	 * @param amount Size of the record in bytes, no larger than max_record_size()
+	 * @return true if the record was written and committed
+	 * @return false if the ring is out of space and nothing was written
+	 */
+	bool push(const void *src, size_type amount)
+	{
+		reservation record = reserve(amount);
+		if (!record)
+			return false;
+
+		record.output.write(src, amount);
+		commit(record);
+		return true;
+	}
+
+	/**
+	 * @brief Read the next committed record, only the consumer thread may call this
+	 *
+	 * @param record Destination for the record's payload, it stays valid until release
+	 * @return true if a record was read
+	 * @return false if no committed record is available
+	 */
+	bool read(region &record)
+	{
+		while (true)
+		{
+			if (consumer.cursor == consumer.cachedPublished)
+			{
+				consumer.cachedPublished = published.value.load(std::memory_order_acquire);
+				if (consumer.cursor == consumer.cachedPublished)
+					return false;
+			}
+
+			uint32_t header[2];
+			memcpy(header, data + offset(consumer.cursor), header_size);
+
+			if (header[1] & padding_flag)
+			{
+				consumer.cursor += header[0];
+				continue;
+			}
+
+			uint8_t *payload = data + offset(consumer.cursor) + header_size;
+			record = region(payload, header[0]);
+			consumer.cursor += aligned_size(header_size + header[0], header_size);
+			return true;
+		}
+	}
+
+	/**
+	 * @brief Read the next committed record through a reader, only the consumer thread may call this
+	 *
+	 * @param view Destination for a reader over the record's payload, it stays valid until release
+	 * @return true if a record was read
+	 */
+	bool read(memory::reader &view)
+	{
+		region record;
+		if (!read(record))
+			return false;
+
+		view = memory::reader(record);
+		return true;
+	}
+
+	/*! @brief Return the space of every record read so far to the producers, only the consumer thread may call this */
+	void release()
+	{
+		consumerHead.value.store(consumer.cursor, std::memory_order_release);
+	}
+
+	/*! @brief Get the size of the ring in bytes */
+	size_type get_capacity() const
+	{
+		return capacity;
+	}
+
+	/**
+	 * @brief Get the largest payload that fits once the ring has drained, wherever the ring's position is
+	 *
+	 * A record skipping the end of an ordinary ring uses up the skipped space too, with records of at most half
+	 * the capacity the skip and the record always fit together. A mirrored ring never skips, so it fits records of its whole capacity
+	 */
+	size_type max_record_size() const
+	{
+		return (is_mirrored() ? capacity : capacity / 2) - header_size;
+	}
+
+	/*! @brief Check if the ring maps its memory twice back to back */
+	bool is_mirrored() const
+	{
+		return !storage.get_pointer();
+	}
+
+  private:
+	static constexpr uint32_t padding_flag = 1;
+
+	struct alignas(cache_line_size) padded_index
+	{
+		std::atomic<uint64_t> value = 0;
+	};
+
+	/*! @brief Producer side state, on its own cache line */
+	struct alignas(cache_line_size) single_producer_state
+	{
+		uint64_t tail = 0;
+		uint64_t cachedHead = 0;
+	};
+
+	struct alignas(cache_line_size) multiple_producer_state
+	{
+		std::atomic<uint64_t> tail = 0;
+	};
+
+	/*! @brief Consumer side state, on its own cache line */
+	struct alignas(cache_line_size) consumer_state
+	{
+		uint64_t cursor = 0;
+		uint64_t cachedPublished = 0;
+	};
+
+	size_type offset(uint64_t position) const
+	{
+		return position & (capacity - 1);
+	}
+
+	/*! @brief Place a record at or after start, skipping to the front if it would split across the end of an ordinary ring */
+	void place(uint64_t start, size_type total, uint64_t &recordStart, uint64_t &end) const
+	{
+		recordStart = start;
+		if (storage.get_pointer() && offset(start) + total > capacity)
+			recordStart = start + (capacity - offset(start));
+		end = recordStart + total;
+	}
+
+	void write_header(uint64_t position, uint32_t size, uint32_t flags)
+	{
+		const uint32_t header[2] = {size, flags};
+		memcpy(data + offset(position), header, header_size);
+	}
+
+	static void pause()
+	{
+#if defined(__x86_64__) || defined(__i386__)
+		_mm_pause();
+#endif
+	}
+
+#ifdef MEMORY_HAS_MIRRORED_MAPPING
+	/*! @brief Map a memory file twice back to back, so accesses past the end wrap to the front */
+	static uint8_t *map_mirrored(size_type size)
+	{
+		assert(size % page_size == 0 && "Mirrored byte ring capacity must be a multiple of the page size");
+
+		const int fd = memfd_create("memory::byte_ring", MFD_CLOEXEC);
+		if (fd < 0)
+			throw std::system_error(errno, std::generic_category(), "Failed to create byte ring memory file");
+
+		if (ftruncate(fd, size) != 0)
+		{
+			const int error = errno;
+			close(fd);
+			throw std::system_error(error, std::generic_category(), "Failed to size byte ring memory file");
+		}
+
+		// Reserve both halves first, so nothing else can be mapped in between
+		void *reserved = mmap(nullptr, size * 2, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+		uint8_t *base = static_cast<uint8_t *>(reserved);
+
+		if (reserved == MAP_FAILED ||
+			mmap(base, size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_FIXED, fd, 0) == MAP_FAILED ||
+			mmap(base + size, size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_FIXED, fd, 0) == MAP_FAILED)
+		{
+			const int error = errno;
+			if (reserved != MAP_FAILED)
+				munmap(reserved, size * 2);
+			close(fd);
+			throw std::system_error(error, std::generic_category(), "Failed to map mirrored byte ring");
+		}
+
+		// The mappings keep the memory file alive
+		close(fd);
+		return base;
+	}
+#endif
+
+	std::conditional_t<Mode == producer_mode::single, single_producer_state, multiple_producer_state> producer;
+	padded_index published;
+	padded_index consumerHead;
+	consumer_state consumer;
+
+	size_type capacity;
+	uint8_t *data = nullptr;
+	resource storage;
+};
+
+/*! @brief A byte ring with one producer and one consumer */
+using spsc_byte_ring = basic_byte_ring<producer_mode::single>;
+
+/*! @brief A byte ring with multiple producers and one consumer */
+using mpsc_byte_ring = basic_byte_ring<producer_mode::multiple>;
+
+} // namespace memory
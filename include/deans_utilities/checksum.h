@@ -0,0 +1,410 @@
+#pragma once
+#include "util/memory.h"
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+
+#if defined(__GNUC__) && defined(__x86_64__)
+#include <immintrin.h>
+#define MEMORY_HAS_HARDWARE_CRC32C 1
+#elif defined(__GNUC__) && defined(__aarch64__) && __has_include(<arm_acle.h>)
+#include <arm_acle.h>
+#if defined(__linux__) && __has_include(<sys/auxv.h>)
+#include <sys/auxv.h>
+#endif
+#define MEMORY_HAS_HARDWARE_CRC32C 1
+#endif
+
+#if __has_include(<xxhash.h>)
+#include <xxhash.h>
+#define MEMORY_HAS_XXHASH 1
+#endif
+
+namespace memory
+{
+namespace detail
+{
+	/*! @brief Signature of a CRC32C kernel, working on the raw inverted state */
+	using crc32c_function = uint32_t (*)(uint32_t state, const uint8_t *data, std::size_t amount);
+
+	/*! @brief Slice by 8 lookup tables of the reflected Castagnoli polynomial */
+	constexpr std::array<std::array<uint32_t, 256>, 8> crc32c_tables = [] {
+		std::array<std::array<uint32_t, 256>, 8> tables{};
+
+		for (uint32_t i = 0; i < 256; ++i)
+		{
+			uint32_t crc = i;
+			for (int bit = 0; bit < 8; ++bit)
+				crc = (crc >> 1) ^ (0x82F63B78u & (0u - (crc & 1)));
+			tables[0][i] = crc;
+		}
+
+		for (uint32_t i = 0; i < 256; ++i)
+			for (std::size_t slice = 1; slice < 8; ++slice)
+				tables[slice][i] = (tables[slice - 1][i] >> 8) ^ tables[0][tables[slice - 1][i] & 0xFF];
+
+		return tables;
+	}();
+
+	inline uint32_t crc32c_software(uint32_t state, const uint8_t *data, std::size_t amount)
+	{
+		for (; amount >= 8; amount -= 8, data += 8)
+		{
+			uint32_t low;
+			uint32_t high;
+			memcpy(&low, data, 4);
+			memcpy(&high, data + 4, 4);
+			low = to_little_endian(low) ^ state;
+			high = to_little_endian(high);
+
+			state = crc32c_tables[7][low & 0xFF] ^ crc32c_tables[6][(low >> 8) & 0xFF] ^ crc32c_tables[5][(low >> 16) & 0xFF] ^
+					crc32c_tables[4][low >> 24] ^ crc32c_tables[3][high & 0xFF] ^ crc32c_tables[2][(high >> 8) & 0xFF] ^
+					crc32c_tables[1][(high >> 16) & 0xFF] ^ crc32c_tables[0][high >> 24];
+		}
+
+		for (; amount != 0; --amount, ++data)
+			state = (state >> 8) ^ crc32c_tables[0][(state ^ *data) & 0xFF];
+
+		return state;
+	}
+
+#if defined(MEMORY_HAS_HARDWARE_CRC32C) && defined(__x86_64__)
+	__attribute__((target("sse4.2"))) inline uint32_t crc32c_sse42(uint32_t state, const uint8_t *data, std::size_t amount)
+	{
+		for (; amount != 0 && (reinterpret_cast<std::uintptr_t>(data) & 7); --amount, ++data)
+			state = _mm_crc32_u8(state, *data);
+
+		uint64_t wideState = state;
+		for (; amount >= 8; amount -= 8, data += 8)
+		{
+			uint64_t word;
+			memcpy(&word, data, 8);
+			wideState = _mm_crc32_u64(wideState, word);
+		}
+		state = uint32_t(wideState);
+
+		for (; amount != 0; --amount, ++data)
+			state = _mm_crc32_u8(state, *data);
+
+		return state;
+	}
+
+	/*! @brief Use the SSE4.2 crc32 instruction if the cpu supports it */
+	inline crc32c_function select_crc32c()
+	{
+		__builtin_cpu_init();
+		if (__builtin_cpu_supports("sse4.2"))
+			return &crc32c_sse42;
+		return &crc32c_software;
+	}
+#elif defined(MEMORY_HAS_HARDWARE_CRC32C)
+	__attribute__((target("+crc"))) inline uint32_t crc32c_armv8(uint32_t state, const uint8_t *data, std::size_t amount)
+	{
+		for (; amount != 0 && (reinterpret_cast<std::uintptr_t>(data) & 7); --amount, ++data)
+			state = __crc32cb(state, *data);
+
+		for (; amount >= 8; amount -= 8, data += 8)
+		{
+			uint64_t word;
+			memcpy(&word, data, 8);
+			state = __crc32cd(state, word);
+		}
+
+		for (; amount != 0; --amount, ++data)
+			state = __crc32cb(state, *data);
+
+		return state;
+	}
+
+	/*! @brief Use the ARMv8 crc32 instructions if the cpu supports them */
+	inline crc32c_function select_crc32c()
+	{
+#if defined(__ARM_FEATURE_CRC32)
+		return &crc32c_armv8;
+#elif defined(__linux__) && __has_include(<sys/auxv.h>)
+		constexpr unsigned long hwcap_crc32 = 1ul << 7; // HWCAP_CRC32
+		if (getauxval(AT_HWCAP) & hwcap_crc32)
+			return &crc32c_armv8;
+		return &crc32c_software;
+#else
+		return &crc32c_software;
+#endif
+	}
+#else
+	inline crc32c_function select_crc32c()
+	{
+		return &crc32c_software;
+	}
+#endif
+} // namespace detail
+
+/**
+ * @brief Compute the CRC32C (Castagnoli) checksum of data
+ *
+ * The kernel is chosen at runtime, the crc32 instructions of SSE4.2 or ARMv8 are used where supported,
+ * with a slice by 8 table fallback. Checksums chain, crc32c(b, crc32c(a)) is the checksum of a followed by b
+ *
+ * @param data Pointer to the data
+ * @param amount Number of bytes
+ * @param previous Checksum of the preceding data, 0 to start a new checksum
+ * @return uint32_t The checksum
+ */
+inline uint32_t crc32c(const void *data, std::size_t amount, uint32_t previous = 0)
+{
+	static const detail::crc32c_function kernel = detail::select_crc32c();
+	return ~kernel(~previous, static_cast<const uint8_t *>(data), amount);
+}
+
+/**
+ * @brief Incremental CRC32C, for basic_checksum_writer
+ *
+ */
+struct crc32c_hasher
+{
+	using digest_type = uint32_t;
+
+	void update(const void *data, std::size_t amount)
+	{
+		checksum = crc32c(data, amount, checksum);
+	}
+
+	digest_type digest() const
+	{
+		return checksum;
+	}
+
+	void reset()
+	{
+		checksum = 0;
+	}
+
+  private:
+	uint32_t checksum = 0;
+};
+
+#ifdef MEMORY_HAS_XXHASH
+/**
+ * @brief Incremental 64 bit xxHash3, for basic_checksum_writer
+ *
+ * @warning Requires linking libxxhash, or defining XXH_INLINE_ALL before including this header
+ */
+struct xxh3_hasher
+{
+	using digest_type = uint64_t;
+
+	/*! @throws std::bad_alloc if the hash state cannot be allocated */
+	xxh3_hasher()
+		: state(XXH3_createState())
+	{
+		if (!state)
+			throw std::bad_alloc();
+		XXH3_64bits_reset(state.get());
+	}
+
+	void update(const void *data, std::size_t amount)
+	{
+		XXH3_64bits_update(state.get(), data, amount);
+	}
+
+	digest_type digest() const
+	{
+		return XXH3_64bits_digest(state.get());
+	}
+
+	void reset()
+	{
+		XXH3_64bits_reset(state.get());
+	}
+
+  private:
+	struct state_deleter
+	{
+		void operator()(XXH3_state_t *hashState) const
+		{
+			XXH3_freeState(hashState);
+		}
+	};
+
+	std::unique_ptr<XXH3_state_t, state_deleter> state;
+};
+#endif
+
+/**
+ * @brief A memory writer that checksums data as it is written, while it is still in cache
+ *
+ * Only successful writes are checksummed, so the digest always covers exactly the bytes written
+ *
+ * @tparam HasherT Incremental hash, eg crc32c_hasher or xxh3_hasher
+ */
+template <typename HasherT = crc32c_hasher>
+struct basic_checksum_writer
+{
+	using size_type = std::size_t;
+	using digest_type = typename HasherT::digest_type;
+
+	/**
+	 * @brief Constructor
+	 *
+	 * @param destination Memory region to write to
+	 */
+	basic_checksum_writer(region destination)
+		: output(destination)
+	{
+	}
+
+	/**
+	 * @brief Write and checksum data
+	 *
+	 * @param src Pointer to start of data
+	 * @param amount Number of bytes to write
+	 * @return true if data was written
+	 * @return false if buffer is out of space and no data was written
+	 */
+	bool write(const void *src, size_type amount)
+	{
+		return copy_and_hash(src, amount, false);
+	}
+
+	/**
+	 * @brief Write and checksum data with non temporal stores, the checksum is taken from the source
+	 *
+	 * @param src Pointer to start of data
+	 * @param amount Number of bytes to write, non temporal stores are used from streaming_threshold
+	 * @return true if data was written
+	 * @return false if buffer is out of space and no data was written
+	 */
+	bool write_streaming(const void *src, size_type amount)
+	{
+		return copy_and_hash(src, amount, amount >= streaming_threshold);
+	}
+
+	/**
+	 * @brief Write and checksum an object
+	 *
+	 * @tparam ObjectT Object type
+	 * @param object Object to write
+	 * @return true if data was written
+	 * @return false if buffer is out of space and no data was written
+	 */
+	template <typename ObjectT>
+	bool write(const ObjectT &object)
+	{
+		if (!output.write(object))
+			return false;
+
+		hasher.update(&object, sizeof(ObjectT));
+		return true;
+	}
+
+	/**
+	 * @brief Write and checksum an object in little endian byte order
+	 *
+	 * @tparam ObjectT Object type
+	 * @param object Object to write
+	 * @return true if data was written
+	 * @return false if buffer is out of space and no data was written
+	 */
+	template <typename ObjectT>
+	bool write_le(const ObjectT &object)
+	{
+		return write(to_little_endian(object));
+	}
+
+	/**
+	 * @brief Write and checksum an object in big endian byte order
+	 *
+	 * @tparam ObjectT Object type
+	 * @param object Object to write
+	 * @return true if data was written
+	 * @return false if buffer is out of space and no data was written
+	 */
+	template <typename ObjectT>
+	bool write_be(const ObjectT &object)
+	{
+		return write(to_big_endian(object));
+	}
+
+	/**
+	 * @brief Write and checksum a contigious range
+	 *
+	 * @tparam RangeT Range Type
+	 * @param range Range to write
+	 * @return true if data was written
+	 * @return false if buffer is out of space and no data was written
+	 */
+	template <typename RangeT>
+	bool write(const RangeT &range) requires std::ranges::contiguous_range<RangeT> && std::ranges::sized_range<RangeT>
+	{
+		static_assert(std::is_trivially_copyable_v<std::ranges::range_value_t<RangeT>>, "Only ranges of trivially copyable objects can be written");
+		return write(std::ranges::data(range), std::ranges::size(range) * sizeof(std::ranges::range_value_t<RangeT>));
+	}
+
+	/*! @brief Get the checksum of every byte written */
+	digest_type digest() const
+	{
+		return hasher.digest();
+	}
+
+	/*! @brief Get number of unwritten bytes on buffer */
+	size_type bytes_remaining() const
+	{
+		return output.bytes_remaining();
+	}
+
+	/*! @brief Get number of bytes written to buffer */
+	size_type bytes_written() const
+	{
+		return output.bytes_written();
+	}
+
+	/*! @brief Get the underlying writer, writes made through it directly are not checksummed */
+	const writer &get_writer() const
+	{
+		return output;
+	}
+
+	/*! @brief Reset the write position to the start of the region and start a new checksum */
+	void reset()
+	{
+		output.reset();
+		hasher.reset();
+	}
+
+  private:
+	/*! @brief Blocks are hashed straight after they are copied, small enough that the source is still in L1 */
+	static constexpr size_type hash_block_size = 16 * 1024;
+
+	bool copy_and_hash(const void *src, size_type amount, bool streaming)
+	{
+		uint8_t *dest = output.reserve(amount).get_pointer();
+		if (!dest && amount != 0)
+			return false;
+
+		const uint8_t *bytes = static_cast<const uint8_t *>(src);
+		for (size_type offset = 0; offset < amount; offset += hash_block_size)
+		{
+			const size_type block = std::min(hash_block_size, amount - offset);
+			if (streaming)
+				stream_copy(dest + offset, bytes + offset, block);
+			else
+				memcpy(dest + offset, bytes + offset, block);
+			hasher.update(bytes + offset, block);
+		}
+		return true;
+	}
+
+	writer output;
+	HasherT hasher;
+};
+
+/*! @brief A memory writer computing a CRC32C checksum */
+using crc32c_writer = basic_checksum_writer<crc32c_hasher>;
+
+#ifdef MEMORY_HAS_XXHASH
+/*! @brief A memory writer computing a 64 bit xxHash3 */
+using xxh3_writer = basic_checksum_writer<xxh3_hasher>;
+#endif
+
+} // namespace memory
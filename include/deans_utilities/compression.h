@@ -0,0 +1,607 @@
+#pragma once
+#include "util/memory.h"
+#include <memory>
+#include <stdexcept>
+#include <vector>
+
+#if __has_include(<lz4frame.h>)
+#include <lz4frame.h>
+#define MEMORY_HAS_LZ4 1
+#endif
+
+#if __has_include(<zstd.h>)
+#include <zstd.h>
+#define MEMORY_HAS_ZSTD 1
+#endif
+
+namespace memory
+{
+/**
+ * @brief Progress of a single codec step
+ *
+ */
+struct codec_progress
+{
+	/*! @brief Number of input bytes consumed */
+	std::size_t consumed = 0;
+	/*! @brief Number of output bytes produced */
+	std::size_t produced = 0;
+	/*! @brief The flush, frame end or frame being decoded is complete */
+	bool complete = false;
+};
+
+/**
+ * @brief A writer that compresses everything written to it straight into a chain of pooled regions
+ *
+ * Compressed output is placed directly in the free space of the chained writer, no full sized scratch buffer
+ * is needed. Only when the tail of a region is too small for the codec's worst case output does a step go
+ * through a small staging buffer, which is then split across regions
+ *
+ * A codec provides
+ * - input_block_size(), the largest input passed to one compress call
+ * - output_bound(amount), the output space that guarantees compress can consume amount bytes, or flush and finish can make progress
+ * - compress(src, amount, dest), flush(dest) and finish(dest), each returning a codec_progress
+ *
+ * @tparam CodecT Compression codec, eg lz4_compressor or zstd_compressor
+ * @tparam PoolT Pool of the chained writer
+ *
+ * @warning The frame is only complete after finish, the chained writer's data can't be decoded before
+ */
+template <typename CodecT, typename PoolT = resource_pool>
+struct compressing_writer
+{
+	using size_type = std::size_t;
+
+	/**
+	 * @brief Constructor
+	 *
+	 * @param sink Chained writer the compressed frame is written to, must outlive the compressing writer
+	 * @param codec Compression codec
+	 */
+	compressing_writer(ranges::writer<PoolT> &sink, CodecT codec = CodecT())
+		: sink(sink), codec(std::move(codec))
+	{
+	}
+
+	compressing_writer(const compressing_writer &) = delete;
+	compressing_writer &operator=(const compressing_writer &) = delete;
+
+	/**
+	 * @brief Compress data
+	 *
+	 * @param src Pointer to start of data
+	 * @param amount Number of bytes to write
+	 */
+	void write(const void *src, size_type amount)
+	{
+		const uint8_t *bytes = static_cast<const uint8_t *>(src);
+		bytesWritten += amount;
+
+		while (amount != 0)
+		{
+			const size_type chunk = std::min(amount, chunk_limit());
+			const codec_progress progress = step(codec.output_bound(chunk), [&](region dest) { return codec.compress(bytes, chunk, dest); });
+			bytes += progress.consumed;
+			amount -= progress.consumed;
+		}
+	}
+
+	/**
+	 * @brief Compress an object
+	 *
+	 * @tparam ObjectT Object type
+	 * @param object Object to write
+	 */
+	template <typename ObjectT>
+	void write(const ObjectT &object)
+	{
+		write(&object, sizeof(ObjectT));
+	}
+
+	/*! @brief Write out everything buffered by the codec, so the data written so far can be decoded without ending the frame */
+	void flush()
+	{
+		while (!step(codec.output_bound(0), [&](region dest) { return codec.flush(dest); }).complete)
+			;
+	}
+
+	/*! @brief End the frame, writing any buffered data, further writes start a new frame */
+	void finish()
+	{
+		while (!step(codec.output_bound(0), [&](region dest) { return codec.finish(dest); }).complete)
+			;
+	}
+
+	/*! @brief Get the number of uncompressed bytes written */
+	size_type bytes_written() const
+	{
+		return bytesWritten;
+	}
+
+	/*! @brief Get the chained writer holding the compressed data */
+	ranges::writer<PoolT> &get_sink() const
+	{
+		return sink;
+	}
+
+  private:
+	/**
+	 * @brief Get the largest input passed to one compress call
+	 *
+	 * This is the codec's block size, halved until its output bound fits in a whole region of the sink,
+	 * otherwise every step into a small pooled region would go through the staging buffer
+	 */
+	size_type chunk_limit()
+	{
+		// Acquires the first region, so its size is known
+		if (sink.region_size() == 0)
+			sink.free_space();
+
+		if (sink.region_size() != limitRegionSize)
+		{
+			limitRegionSize = sink.region_size();
+			chunkLimit = codec.input_block_size();
+			while (chunkLimit > 1 && codec.output_bound(chunkLimit) > limitRegionSize)
+				chunkLimit /= 2;
+		}
+
+		return chunkLimit;
+	}
+
+	/*! @brief Run one codec step in place when the free space of the current region is large enough, else through the staging buffer */
+	template <typename StepT>
+	codec_progress step(size_type bound, StepT &&codecStep)
+	{
+		const region dest = sink.free_space();
+		if (dest.size() >= bound)
+		{
+			const codec_progress progress = codecStep(dest);
+			sink.commit(progress.produced);
+			return progress;
+		}
+
+		staging.resize(std::max(staging.size(), bound));
+		const codec_progress progress = codecStep(region(staging.data(), staging.size()));
+		sink.write(staging.data(), progress.produced);
+		return progress;
+	}
+
+	ranges::writer<PoolT> &sink;
+	CodecT codec;
+	std::vector<uint8_t> staging;
+	size_type bytesWritten = 0;
+	size_type chunkLimit = 0;
+	/*! @brief Region size chunkLimit was computed for */
+	size_type limitRegionSize = 0;
+};
+
+/**
+ * @brief A reader that decompresses a frame read from a chain of regions
+ *
+ * Compressed input is viewed in place in the source regions. A decoder provides decompress(src, dest),
+ * returning a codec_progress that is complete once the end of the frame has been decoded
+ *
+ * @tparam CodecT Decompression codec, eg lz4_decompressor or zstd_decompressor
+ *
+ * @warning Reads a single frame, input past its end stays available through unread_input
+ */
+template <typename CodecT>
+struct decompressing_reader
+{
+	using size_type = std::size_t;
+
+	/**
+	 * @brief Constructor
+	 *
+	 * @param source Reader over the compressed frame, must outlive the decompressing reader
+	 * @param codec Decompression codec
+	 */
+	decompressing_reader(ranges::reader &source, CodecT codec = CodecT())
+		: source(source), codec(std::move(codec))
+	{
+	}
+
+	decompressing_reader(const decompressing_reader &) = delete;
+	decompressing_reader &operator=(const decompressing_reader &) = delete;
+
+	/**
+	 * @brief Decompress up to amount bytes
+	 *
+	 * @param dest Pointer to the destination
+	 * @param amount Maximum number of bytes to read
+	 * @return size_type Number of bytes read, less than amount only at the end of the frame or input
+	 */
+	size_type read_some(void *dest, size_type amount)
+	{
+		uint8_t *output = static_cast<uint8_t *>(dest);
+		size_type produced = 0;
+
+		while (produced != amount)
+		{
+			const codec_progress progress = step(region(output + produced, amount - produced));
+			produced += progress.produced;
+			if (progress.complete || (progress.consumed == 0 && progress.produced == 0))
+				break;
+		}
+
+		bytesRead += produced;
+		return produced;
+	}
+
+	/**
+	 * @brief Decompress data
+	 *
+	 * @param dest Pointer to the destination
+	 * @param amount Number of bytes to read
+	 * @return true if data was read
+	 * @return false if the frame ended first, the bytes before its end were still read
+	 */
+	bool read(void *dest, size_type amount)
+	{
+		return read_some(dest, amount) == amount;
+	}
+
+	/**
+	 * @brief Decompress an object
+	 *
+	 * @tparam ObjectT Object type
+	 * @param object Object to read into
+	 * @return true if data was read
+	 */
+	template <typename ObjectT>
+	bool read(ObjectT &object)
+	{
+		return read(&object, sizeof(ObjectT));
+	}
+
+	/**
+	 * @brief Decompress the rest of the frame straight into a chain of regions
+	 *
+	 * @param dest Chained writer the decompressed data is written to
+	 * @return size_type Number of bytes decompressed
+	 */
+	template <typename PoolT>
+	size_type read_all(ranges::writer<PoolT> &dest)
+	{
+		size_type produced = 0;
+
+		while (!complete)
+		{
+			const codec_progress progress = step(dest.free_space());
+			dest.commit(progress.produced);
+			produced += progress.produced;
+			if (progress.consumed == 0 && progress.produced == 0)
+				break;
+		}
+
+		bytesRead += produced;
+		return produced;
+	}
+
+	/*! @brief Check if the end of the frame has been decoded */
+	bool is_complete() const
+	{
+		return complete;
+	}
+
+	/*! @brief Get the number of decompressed bytes read */
+	size_type bytes_read() const
+	{
+		return bytesRead;
+	}
+
+	/*! @brief Get compressed input viewed from the source but not yet decoded, eg the start of a following frame */
+	region unread_input() const
+	{
+		return pending;
+	}
+
+  private:
+	codec_progress step(region dest)
+	{
+		if (complete)
+			return codec_progress{0, 0, true};
+
+		if (pending.size() == 0)
+			source.view_chunk(SIZE_MAX, pending);
+
+		// Called even without new input, the codec may still hold decoded output
+		const codec_progress progress = codec.decompress(pending, dest);
+		pending.startPtr += progress.consumed;
+		complete = progress.complete;
+		return progress;
+	}
+
+	ranges::reader &source;
+	CodecT codec;
+	region pending;
+	bool complete = false;
+	size_type bytesRead = 0;
+};
+
+#ifdef MEMORY_HAS_LZ4
+/**
+ * @brief LZ4 frame format compressor, for compressing_writer
+ *
+ * Every compress call ends a block, so with pooled regions smaller than the bound of a 64 KiB block
+ * compressing_writer uses smaller blocks, at some cost in compression ratio
+ *
+ * @warning Requires linking liblz4
+ */
+struct lz4_compressor
+{
+	using size_type = std::size_t;
+
+	/**
+	 * @brief Constructor
+	 *
+	 * @param level Compression level, 0 is the fast default and values from LZ4HC_CLEVEL_MIN use the high compression mode
+	 *
+	 * @throws std::runtime_error if the compression context cannot be created
+	 */
+	lz4_compressor(int level = 0)
+	{
+		LZ4F_cctx *created = nullptr;
+		check(LZ4F_createCompressionContext(&created, LZ4F_VERSION));
+		context.reset(created);
+
+		preferences.frameInfo.blockSizeID = LZ4F_max64KB;
+		preferences.compressionLevel = level;
+		// Nothing is buffered between calls, so the output bound only covers the input passed and shrinks with it
+		preferences.autoFlush = 1;
+	}
+
+	size_type input_block_size() const
+	{
+		return block_size;
+	}
+
+	size_type output_bound(size_type amount) const
+	{
+		return LZ4F_compressBound(amount, &preferences) + (started ? 0 : LZ4F_HEADER_SIZE_MAX);
+	}
+
+	codec_progress compress(const void *src, size_type amount, region dest)
+	{
+		const size_type header = begin(dest);
+		const size_type produced = check(LZ4F_compressUpdate(context.get(), dest.startPtr + header, dest.size() - header, src, amount, nullptr));
+		return codec_progress{amount, header + produced, false};
+	}
+
+	codec_progress flush(region dest)
+	{
+		const size_type header = begin(dest);
+		const size_type produced = check(LZ4F_flush(context.get(), dest.startPtr + header, dest.size() - header, nullptr));
+		return codec_progress{0, header + produced, true};
+	}
+
+	codec_progress finish(region dest)
+	{
+		const size_type header = begin(dest);
+		const size_type produced = check(LZ4F_compressEnd(context.get(), dest.startPtr + header, dest.size() - header, nullptr));
+		started = false;
+		return codec_progress{0, header + produced, true};
+	}
+
+  private:
+	static constexpr size_type block_size = 64 * 1024;
+
+	struct context_deleter
+	{
+		void operator()(LZ4F_cctx *ctx) const
+		{
+			LZ4F_freeCompressionContext(ctx);
+		}
+	};
+
+	static size_type check(size_t result)
+	{
+		if (LZ4F_isError(result))
+			throw std::runtime_error(LZ4F_getErrorName(result));
+		return result;
+	}
+
+	/*! @brief Write the frame header before the first block of a frame */
+	size_type begin(region dest)
+	{
+		if (started)
+			return 0;
+
+		started = true;
+		return check(LZ4F_compressBegin(context.get(), dest.startPtr, dest.size(), &preferences));
+	}
+
+	std::unique_ptr<LZ4F_cctx, context_deleter> context;
+	LZ4F_preferences_t preferences{};
+	bool started = false;
+};
+
+/**
+ * @brief LZ4 frame format decompressor, for decompressing_reader
+ *
+ * @warning Requires linking liblz4
+ */
+struct lz4_decompressor
+{
+	/**
+	 * @brief Constructor
+	 *
+	 * @throws std::runtime_error if the decompression context cannot be created
+	 */
+	lz4_decompressor()
+	{
+		LZ4F_dctx *created = nullptr;
+		const size_t result = LZ4F_createDecompressionContext(&created, LZ4F_VERSION);
+		if (LZ4F_isError(result))
+			throw std::runtime_error(LZ4F_getErrorName(result));
+		context.reset(created);
+	}
+
+	/*! @throws std::runtime_error if the frame is corrupt */
+	codec_progress decompress(region src, region dest)
+	{
+		size_t consumed = src.size();
+		size_t produced = dest.size();
+
+		const size_t result = LZ4F_decompress(context.get(), dest.startPtr, &produced, src.startPtr, &consumed, nullptr);
+		if (LZ4F_isError(result))
+			throw std::runtime_error(LZ4F_getErrorName(result));
+
+		return codec_progress{consumed, produced, result == 0};
+	}
+
+  private:
+	struct context_deleter
+	{
+		void operator()(LZ4F_dctx *ctx) const
+		{
+			LZ4F_freeDecompressionContext(ctx);
+		}
+	};
+
+	std::unique_ptr<LZ4F_dctx, context_deleter> context;
+};
+
+/*! @brief A writer that compresses into an LZ4 frame */
+template <typename PoolT = resource_pool>
+using lz4_writer = compressing_writer<lz4_compressor, PoolT>;
+
+/*! @brief A reader that decompresses an LZ4 frame */
+using lz4_reader = decompressing_reader<lz4_decompressor>;
+#endif
+
+#ifdef MEMORY_HAS_ZSTD
+/**
+ * @brief Zstandard frame format compressor, for compressing_writer
+ *
+ * @warning Requires linking libzstd
+ */
+struct zstd_compressor
+{
+	using size_type = std::size_t;
+
+	/**
+	 * @brief Constructor
+	 *
+	 * @param level Compression level, from ZSTD_minCLevel() to ZSTD_maxCLevel()
+	 *
+	 * @throws std::runtime_error if the compression context cannot be created or the level is rejected
+	 */
+	zstd_compressor(int level = ZSTD_CLEVEL_DEFAULT)
+		: context(ZSTD_createCCtx())
+	{
+		if (!context)
+			throw std::runtime_error("Failed to create zstd compression context");
+		check(ZSTD_CCtx_setParameter(context.get(), ZSTD_c_compressionLevel, level));
+	}
+
+	size_type input_block_size() const
+	{
+		return ZSTD_CStreamInSize();
+	}
+
+	/*! @brief Zstandard streams into any amount of output space */
+	size_type output_bound(size_type) const
+	{
+		return 1;
+	}
+
+	codec_progress compress(const void *src, size_type amount, region dest)
+	{
+		ZSTD_inBuffer input{src, amount, 0};
+		ZSTD_outBuffer output{dest.startPtr, dest.size(), 0};
+		check(ZSTD_compressStream2(context.get(), &output, &input, ZSTD_e_continue));
+		return codec_progress{input.pos, output.pos, false};
+	}
+
+	codec_progress flush(region dest)
+	{
+		return end_directive(dest, ZSTD_e_flush);
+	}
+
+	codec_progress finish(region dest)
+	{
+		return end_directive(dest, ZSTD_e_end);
+	}
+
+  private:
+	struct context_deleter
+	{
+		void operator()(ZSTD_CCtx *ctx) const
+		{
+			ZSTD_freeCCtx(ctx);
+		}
+	};
+
+	static size_type check(size_t result)
+	{
+		if (ZSTD_isError(result))
+			throw std::runtime_error(ZSTD_getErrorName(result));
+		return result;
+	}
+
+	/*! @brief Flush or end the frame, complete once nothing remains to be written */
+	codec_progress end_directive(region dest, ZSTD_EndDirective directive)
+	{
+		ZSTD_inBuffer input{nullptr, 0, 0};
+		ZSTD_outBuffer output{dest.startPtr, dest.size(), 0};
+		const size_type remaining = check(ZSTD_compressStream2(context.get(), &output, &input, directive));
+		return codec_progress{0, output.pos, remaining == 0};
+	}
+
+	std::unique_ptr<ZSTD_CCtx, context_deleter> context;
+};
+
+/**
+ * @brief Zstandard frame format decompressor, for decompressing_reader
+ *
+ * @warning Requires linking libzstd
+ */
+struct zstd_decompressor
+{
+	/**
+	 * @brief Constructor
+	 *
+	 * @throws std::runtime_error if the decompression context cannot be created
+	 */
+	zstd_decompressor()
+		: context(ZSTD_createDCtx())
+	{
+		if (!context)
+			throw std::runtime_error("Failed to create zstd decompression context");
+	}
+
+	/*! @throws std::runtime_error if the frame is corrupt */
+	codec_progress decompress(region src, region dest)
+	{
+		ZSTD_inBuffer input{src.startPtr, src.size(), 0};
+		ZSTD_outBuffer output{dest.startPtr, dest.size(), 0};
+
+		const size_t result = ZSTD_decompressStream(context.get(), &output, &input);
+		if (ZSTD_isError(result))
+			throw std::runtime_error(ZSTD_getErrorName(result));
+
+		return codec_progress{input.pos, output.pos, result == 0};
+	}
+
+  private:
+	struct context_deleter
+	{
+		void operator()(ZSTD_DCtx *ctx) const
+		{
+			ZSTD_freeDCtx(ctx);
+		}
+	};
+
+	std::unique_ptr<ZSTD_DCtx, context_deleter> context;
+};
+
+/*! @brief A writer that compresses into a Zstandard frame */
+template <typename PoolT = resource_pool>
+using zstd_writer = compressing_writer<zstd_compressor, PoolT>;
+
+/*! @brief A reader that decompresses a Zstandard frame */
+using zstd_reader = decompressing_reader<zstd_decompressor>;
+#endif
+
+} // namespace memory
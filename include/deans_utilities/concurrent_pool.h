@@ -0,0 +1,285 @@
+#pragma once
+#include "util/concurrent_region_stack.h"
+#include "util/memory.h"
+#include <atomic>
+#include <memory>
+#include <mutex>
+
+namespace memory
+{
+namespace detail
+{
+	/*! @brief Get a small sequential index for the calling thread, used to spread threads across shards */
+	inline uint32_t thread_index()
+	{
+		static std::atomic<uint32_t> threadCount = 0;
+		static thread_local const uint32_t index = threadCount.fetch_add(1, std::memory_order_relaxed);
+		return index;
+	}
+
+	/*! @brief Get a process unique identifier, identifiers are never reused */
+	inline uint64_t unique_id()
+	{
+		static std::atomic<uint64_t> idCount = 0;
+		return idCount.fetch_add(1, std::memory_order_relaxed) + 1;
+	}
+
+	/**
+	 * @brief The magazines a thread holds for every concurrent pool it has used
+	 *
+	 * On thread exit every magazine whose pool is still alive is flushed back to that pool
+	 *
+	 * @tparam StateT Shared state of a pool, must have an id member and a flush(std::vector<region> &) function
+	 */
+	template <typename StateT>
+	struct thread_magazines
+	{
+		struct entry
+		{
+			uint64_t id;
+			std::weak_ptr<StateT> owner;
+			std::vector<region> cached;
+		};
+
+		/*! @brief Flushes all magazines of live pools */
+		~thread_magazines()
+		{
+			for (entry &magazine : entries)
+				if (std::shared_ptr<StateT> state = magazine.owner.lock())
+					state->flush(magazine.cached);
+		}
+
+		/**
+		 * @brief Find the magazine for a pool, creating it if needed
+		 *
+		 * @param state Shared state of the pool
+		 * @return std::vector<region>& cached regions for that pool
+		 */
+		std::vector<region> &find(const std::shared_ptr<StateT> &state)
+		{
+			if (last < entries.size() && entries[last].id == state->id)
+				return entries[last].cached;
+
+			for (last = 0; last < entries.size(); ++last)
+				if (entries[last].id == state->id)
+					return entries[last].cached;
+
+			// Drop magazines of destroyed pools, their regions were released with the pool
+			std::erase_if(entries, [](const entry &magazine) { return magazine.owner.expired(); });
+
+			entry &magazine = entries.emplace_back(state->id, state, std::vector<region>());
+			magazine.cached.reserve(state->magazineSize * 2);
+			last = entries.size() - 1;
+			return magazine.cached;
+		}
+
+		std::vector<entry> entries;
+		std::size_t last = 0;
+	};
+} // namespace detail
+
+/**
+ * @brief A thread safe pool of memory allocations
+ *
+ * Each thread acquires from and releases to its own magazine of cached regions without taking a lock,
+ * magazines are refilled from and flushed to a sharded lock free depot in batches of magazineSize regions
+ *
+ * @tparam BackingT Backing store of the pooled regions
+ *
+ * @warning Releases all allocated regions once the pool and every thread flushing to it are done with it
+ */
+template <backing_store BackingT = heap_backing>
+struct basic_concurrent_resource_pool
+{
+	/**
+	 * @brief Constructor
+	 * @param resourceSize The size of allocated regions, at least concurrent_region_stack::min_region_size
+	 * @param allocationAmount Number of regions to allocate when the depot is empty, this should not be zero
+	 * @param magazineSize Number of regions exchanged between a thread and the depot at once, this should not be zero
+	 * @param options Alignment and page backing of every region
+	 */
+	basic_concurrent_resource_pool(std::size_t resourceSize, uint32_t allocationAmount = 64, uint32_t magazineSize = 32,
+								   const resource_options &options = {})
+		: state(std::make_shared<shared_state>(resourceSize, std::max(allocationAmount, magazineSize), magazineSize, options)),
+		  registration(this, &release_callback, &release_range_callback)
+	{
+		assert(resourceSize >= concurrent_region_stack::min_region_size && "Resource size is too small for the depot");
+		assert(allocationAmount != 0 && "Allocation amount cannot be zero");
+		assert(magazineSize != 0 && "Magazine size cannot be zero");
+	}
+
+	basic_concurrent_resource_pool(const basic_concurrent_resource_pool &) = delete;
+	basic_concurrent_resource_pool &operator=(const basic_concurrent_resource_pool &) = delete;
+
+	/*! @brief Acquire a region from the pool*/
+	region acquire()
+	{
+		std::vector<region> &cached = magazine();
+
+		if (cached.empty())
+			state->refill(cached);
+
+		region output = cached.back();
+		cached.pop_back();
+		return output;
+	}
+
+	/*! @brief Acquire a region that is released back to the pool when the handle is destroyed, on any thread */
+	pooled_region acquire_pooled()
+	{
+		return pooled_region(acquire(), registration.index());
+	}
+
+	/**
+	 * @brief Release a reserved region
+	 *
+	 * @param target region to be released, may be released by a different thread than acquired it
+	 *
+	 * @warning this does not check if region is acquired
+	 */
+	void release(region target)
+	{
+		std::vector<region> &cached = magazine();
+		cached.push_back(target);
+
+		if (cached.size() >= state->magazineSize * 2)
+			state->flush(cached, state->magazineSize);
+	}
+
+	/**
+	 * @brief Bulk release regions straight to the shared depot, they are linked locally and pushed with a single compare exchange
+	 *
+	 * @param regionRange A range of regions to be released, may be released by a different thread than acquired them
+	 */
+	void release(const auto &regionRange)
+	{
+		state->deposit(regionRange);
+	}
+
+	/*! @brief Return every region cached by the calling thread to the shared depot */
+	void flush_thread_cache()
+	{
+		state->flush(magazine());
+	}
+
+	/*! @brief Get the options of the pooled regions, every region starts aligned to options.alignment */
+	const resource_options &get_options() const
+	{
+		return state->allocator.get_options();
+	}
+
+  private:
+	struct alignas(cache_line_size) depot_shard
+	{
+		concurrent_region_stack regions;
+	};
+
+	static constexpr uint32_t shard_count = 8;
+
+	struct shared_state
+	{
+		shared_state(std::size_t resourceSize, uint32_t allocationAmount, uint32_t magazineSize, const resource_options &options)
+			: id(detail::unique_id()),
+			  resourceSize(resourceSize),
+			  allocationAmount(allocationAmount),
+			  magazineSize(magazineSize),
+			  allocator(options)
+		{
+		}
+
+		/**
+		 * @brief Move up to magazineSize regions from the depot into an empty magazine, allocating if the depot is empty
+		 *
+		 * @param cached magazine to refill
+		 */
+		void refill(std::vector<region> &cached)
+		{
+			const uint32_t home = detail::thread_index();
+
+			for (uint32_t i = 0; i < shard_count && cached.size() < magazineSize; ++i)
+			{
+				depot_shard &shard = shards[(home + i) % shard_count];
+
+				region popped;
+				while (cached.size() < magazineSize && shard.regions.pop(popped))
+					cached.push_back(popped);
+			}
+
+			if (!cached.empty())
+				return;
+
+			std::vector<region> allocated;
+			{
+				std::lock_guard lock(allocatorMutex);
+				allocator.alloc_objects(resourceSize, allocationAmount, allocated);
+			}
+
+			cached.insert(cached.end(), allocated.end() - magazineSize, allocated.end());
+			allocated.resize(allocated.size() - magazineSize);
+
+			if (!allocated.empty())
+				flush(allocated);
+		}
+
+		/**
+		 * @brief Move regions from a magazine to the depot
+		 *
+		 * @param cached magazine to flush
+		 * @param count number of regions to flush, defaults to all of them
+		 */
+		void flush(std::vector<region> &cached, std::size_t count = SIZE_MAX)
+		{
+			count = std::min(count, cached.size());
+			if (count == 0)
+				return;
+
+			deposit(std::ranges::subrange(cached.end() - count, cached.end()));
+			cached.resize(cached.size() - count);
+		}
+
+		/*! @brief Push regions onto the calling thread's depot shard with a single compare exchange */
+		template <typename RangeT>
+		void deposit(const RangeT &regionRange)
+		{
+			shards[detail::thread_index() % shard_count].regions.push(regionRange);
+		}
+
+		const uint64_t id;
+		const std::size_t resourceSize;
+		const uint32_t allocationAmount;
+		const uint32_t magazineSize;
+
+		depot_shard shards[shard_count];
+
+		std::mutex allocatorMutex;
+		basic_resource_allocator<BackingT> allocator;
+	};
+
+	static void release_callback(void *pool, region target)
+	{
+		static_cast<basic_concurrent_resource_pool *>(pool)->release(target);
+	}
+
+	static void release_range_callback(void *pool, std::span<region> targets)
+	{
+		static_cast<basic_concurrent_resource_pool *>(pool)->release(targets);
+	}
+
+	/*! @brief Get the calling thread's magazine for this pool */
+	std::vector<region> &magazine()
+	{
+		static thread_local detail::thread_magazines<shared_state> magazines;
+		return magazines.find(state);
+	}
+
+	std::shared_ptr<shared_state> state;
+	detail::pool_registration registration;
+};
+
+/*! @brief A thread safe pool of heap allocated regions */
+using concurrent_resource_pool = basic_concurrent_resource_pool<heap_backing>;
+
+/*! @brief A thread safe pool of page locked regions */
+using concurrent_pinned_resource_pool = basic_concurrent_resource_pool<pinned_backing>;
+
+} // namespace memory
@@ -0,0 +1,161 @@
+#pragma once
+#include "util/memory.h"
+#include <atomic>
+
+namespace memory
+{
+/**
+ * @brief A lock free multi producer multi consumer stack of free regions
+ *
+ * This is a Treiber stack, the link to the next free region is stored inside the free region itself,
+ * so no storage is needed beyond a single word for the head. The head packs a modification tag above
+ * the pointer bits so ABA is detected on compare exchange.
+ *
+ * @warning Regions must be at least min_region_size bytes and aligned to region_alignment,
+ * the first min_region_size bytes of a pushed region are overwritten.
+ * Memory of pushed regions must stay mapped while the stack is in use, as a racing pop may read the link
+ * of a region that was just removed.
+ */
+struct concurrent_region_stack
+{
+	/*! @brief Minimum size of a pushed region */
+	static constexpr std::size_t min_region_size = 2 * sizeof(uint8_t *);
+
+	/*! @brief Minimum alignment of a pushed region */
+	static constexpr std::size_t region_alignment = alignof(uint8_t *);
+
+	concurrent_region_stack() = default;
+
+	concurrent_region_stack(const concurrent_region_stack &) = delete;
+	concurrent_region_stack &operator=(const concurrent_region_stack &) = delete;
+
+	/**
+	 * @brief Push a free region
+	 *
+	 * @param target region to push
+	 */
+	void push(region target)
+	{
+		node *link = to_node(target);
+		push_chain(link, link);
+	}
+
+	/**
+	 * @brief Push a range of free regions with a single compare exchange
+	 *
+	 * @param regionRange range of regions to push
+	 */
+	template <typename RangeT>
+	void push(const RangeT &regionRange) requires std::ranges::input_range<RangeT>
+	{
+		node *first = nullptr;
+		node *last = nullptr;
+
+		for (const region &target : regionRange)
+		{
+			node *link = to_node(target);
+			store(link->next, reinterpret_cast<uint8_t *>(first));
+			first = link;
+			if (!last)
+				last = link;
+		}
+
+		if (first)
+			push_chain(first, last);
+	}
+
+	/**
+	 * @brief Pop a free region
+	 *
+	 * @param output region that was popped
+	 * @return true if a region was popped
+	 * @return false if the stack was empty, output is unchanged
+	 */
+	bool pop(region &output)
+	{
+		uint64_t oldHead = head.load(std::memory_order_acquire);
+
+		while (node *link = pointer(oldHead))
+		{
+			node *next = reinterpret_cast<node *>(load(link->next));
+			if (head.compare_exchange_weak(oldHead, pack(next, tag(oldHead) + 1), std::memory_order_acquire, std::memory_order_acquire))
+			{
+				output = region(reinterpret_cast<uint8_t *>(link), load(link->end));
+				return true;
+			}
+		}
+
+		return false;
+	}
+
+	/**
+	 * @brief Check if the stack is empty
+	 *
+	 * @warning The result may be outdated as soon as it is returned
+	 */
+	bool empty() const
+	{
+		return pointer(head.load(std::memory_order_relaxed)) == nullptr;
+	}
+
+  private:
+	/*! @brief The link stored at the start of every free region */
+	struct node
+	{
+		uint8_t *next;
+		uint8_t *end;
+	};
+
+	static constexpr unsigned pointer_bits = sizeof(uint8_t *) == 8 ? 48 : 32;
+	static constexpr uint64_t pointer_mask = (uint64_t(1) << pointer_bits) - 1;
+
+	static uint64_t pack(node *link, uint64_t tag)
+	{
+		return (reinterpret_cast<uint64_t>(link) & pointer_mask) | (tag << pointer_bits);
+	}
+
+	static node *pointer(uint64_t packed)
+	{
+		return reinterpret_cast<node *>(packed & pointer_mask);
+	}
+
+	static uint64_t tag(uint64_t packed)
+	{
+		return packed >> pointer_bits;
+	}
+
+	// Links are accessed atomically, a racing pop may read a link that is being rewritten
+	static uint8_t *load(uint8_t *&value)
+	{
+		return std::atomic_ref<uint8_t *>(value).load(std::memory_order_relaxed);
+	}
+
+	static void store(uint8_t *&value, uint8_t *desired)
+	{
+		std::atomic_ref<uint8_t *>(value).store(desired, std::memory_order_relaxed);
+	}
+
+	static node *to_node(const region &target)
+	{
+		assert(target.size() >= min_region_size && "Region is too small to hold a free list link");
+		assert(reinterpret_cast<std::size_t>(target.startPtr) % region_alignment == 0 && "Region is not aligned for a free list link");
+		assert((reinterpret_cast<uint64_t>(target.startPtr) & ~pointer_mask) == 0 && "Region address does not fit a tagged pointer");
+
+		node *link = reinterpret_cast<node *>(target.startPtr);
+		store(link->end, target.endPtr);
+		return link;
+	}
+
+	void push_chain(node *first, node *last)
+	{
+		uint64_t oldHead = head.load(std::memory_order_relaxed);
+		do
+		{
+			store(last->next, reinterpret_cast<uint8_t *>(pointer(oldHead)));
+		} while (!head.compare_exchange_weak(oldHead, pack(first, tag(oldHead) + 1), std::memory_order_release, std::memory_order_relaxed));
+	}
+
+	std::atomic<uint64_t> head = 0;
+};
+
+} // namespace memory
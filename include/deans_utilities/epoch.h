@@ -0,0 +1,247 @@
+#pragma once
+#include "util/concurrent_pool.h"
+#include "util/memory.h"
+#include <atomic>
+#include <mutex>
+
+namespace memory
+{
+/**
+ * @brief Epoch based reclamation of regions that other threads may still be reading
+ *
+ * Readers pin the current epoch while they hold references to shared regions. A region passed to
+ * deferred_release is returned to the pool once the epoch has advanced twice past its release, at which
+ * point no pinned reader can still see it. Regions are returned in batches, one batch per epoch
+ *
+ * @tparam PoolT Pool the regions are returned to, it must accept releases from any participating thread
+ *
+ * @warning Every participant must be destroyed before the reclaimer, outstanding regions are released on deconstruction
+ */
+template <typename PoolT = concurrent_resource_pool>
+struct epoch_reclaimer
+{
+	/*! @brief unsigned integer type*/
+	using size_type = std::size_t;
+
+  private:
+	/*! @brief Epoch of a participant that isn't pinned */
+	static constexpr uint64_t quiescent = UINT64_MAX;
+
+	struct alignas(cache_line_size) participant_record
+	{
+		std::atomic<uint64_t> epoch = quiescent;
+	};
+
+	/*! @brief Regions released during one epoch */
+	struct epoch_bag
+	{
+		uint64_t epoch;
+		std::vector<region> regions;
+	};
+
+  public:
+	struct participant;
+
+	/**
+	 * @brief Keeps the calling participant pinned to an epoch while alive, regions it can see are not reclaimed
+	 *
+	 */
+	struct pin_guard
+	{
+		pin_guard(participant &owner)
+			: owner(&owner)
+		{
+			owner.pin();
+		}
+
+		pin_guard(const pin_guard &) = delete;
+		pin_guard &operator=(const pin_guard &) = delete;
+
+		/*! @brief Deconstructor, marks the participant quiescent */
+		~pin_guard()
+		{
+			owner->unpin();
+		}
+
+	  private:
+		participant *owner;
+	};
+
+	/**
+	 * @brief A thread taking part in reclamation, each thread should only use its own participant
+	 *
+	 */
+	struct participant
+	{
+		/**
+		 * @brief Register a participant
+		 *
+		 * @param reclaimer Reclaimer to participate in
+		 * @param reclaimBatch Number of deferred releases between automatic reclamation attempts, zero disables them
+		 */
+		participant(epoch_reclaimer &reclaimer, uint32_t reclaimBatch = 64)
+			: reclaimer(reclaimer), reclaimBatch(reclaimBatch)
+		{
+			std::lock_guard lock(reclaimer.participantMutex);
+			reclaimer.participants.push_back(&record);
+		}
+
+		participant(const participant &) = delete;
+		participant &operator=(const participant &) = delete;
+
+		/*! @brief Deconstructor, regions that are not yet safe to release are handed to the reclaimer */
+		~participant()
+		{
+			assert(record.epoch.load(std::memory_order_relaxed) == quiescent && "Participant destroyed while pinned");
+
+			std::lock_guard lock(reclaimer.participantMutex);
+			std::erase(reclaimer.participants, &record);
+
+			for (epoch_bag &bag : bags)
+				reclaimer.orphans.push_back(std::move(bag));
+		}
+
+		/*! @brief Pin the current epoch, prefer pin_guard */
+		void pin()
+		{
+			assert(record.epoch.load(std::memory_order_relaxed) == quiescent && "Participant is already pinned");
+
+			// A sequentially consistent exchange publishes the pin before any shared region is read
+			record.epoch.exchange(reclaimer.globalEpoch.load(std::memory_order_relaxed), std::memory_order_seq_cst);
+		}
+
+		/*! @brief Mark the participant quiescent, it holds no references to shared regions */
+		void unpin()
+		{
+			record.epoch.store(quiescent, std::memory_order_release);
+		}
+
+		/**
+		 * @brief Release a region once no pinned reader can still be reading it
+		 *
+		 * @param target Region to release, it must already be unreachable for new readers
+		 */
+		void deferred_release(region target)
+		{
+			const uint64_t epoch = reclaimer.globalEpoch.load(std::memory_order_seq_cst);
+
+			if (bags.empty() || bags.back().epoch != epoch)
+				bags.push_back(epoch_bag{epoch, {}});
+			bags.back().regions.push_back(target);
+
+			if (reclaimBatch != 0 && ++sinceReclaim >= reclaimBatch)
+				reclaim();
+		}
+
+		/**
+		 * @brief Try to advance the epoch, then release every batch that is now safe
+		 *
+		 * @return size_type Number of regions released to the pool
+		 */
+		size_type reclaim()
+		{
+			sinceReclaim = 0;
+			reclaimer.try_advance();
+			return reclaimer.release_safe(bags);
+		}
+
+	  private:
+		friend struct epoch_reclaimer;
+
+		epoch_reclaimer &reclaimer;
+		participant_record record;
+		std::vector<epoch_bag> bags;
+		uint32_t reclaimBatch;
+		uint32_t sinceReclaim = 0;
+	};
+
+	/**
+	 * @brief Constructor
+	 *
+	 * @param resourcePool Pool reclaimed regions are released to, must outlive the reclaimer
+	 */
+	epoch_reclaimer(PoolT &resourcePool)
+		: resourcePool(resourcePool)
+	{
+	}
+
+	epoch_reclaimer(const epoch_reclaimer &) = delete;
+	epoch_reclaimer &operator=(const epoch_reclaimer &) = delete;
+
+	/*! @brief Deconstructor, releases every outstanding region */
+	~epoch_reclaimer()
+	{
+		assert(participants.empty() && "Participants must be destroyed before their reclaimer");
+
+		for (const epoch_bag &bag : orphans)
+			for (const region &target : bag.regions)
+				resourcePool.release(target);
+	}
+
+	/**
+	 * @brief Advance the epoch if every pinned participant has observed the current one
+	 *
+	 * @return true if the epoch advanced
+	 */
+	bool try_advance()
+	{
+		uint64_t epoch = globalEpoch.load(std::memory_order_seq_cst);
+
+		{
+			std::lock_guard lock(participantMutex);
+			for (const participant_record *other : participants)
+			{
+				const uint64_t pinned = other->epoch.load(std::memory_order_seq_cst);
+				if (pinned != quiescent && pinned != epoch)
+					return false;
+			}
+		}
+
+		if (!globalEpoch.compare_exchange_strong(epoch, epoch + 1, std::memory_order_seq_cst))
+			return false;
+
+		// Orphaned batches of destroyed participants are released by whoever advances
+		std::lock_guard lock(participantMutex);
+		release_safe(orphans);
+		return true;
+	}
+
+	/*! @brief Get the current epoch */
+	uint64_t current_epoch() const
+	{
+		return globalEpoch.load(std::memory_order_relaxed);
+	}
+
+  private:
+	/**
+	 * @brief Release every batch at least two epochs old
+	 *
+	 * @param bags Batches in epoch order, released batches are removed
+	 * @return size_type Number of regions released
+	 */
+	size_type release_safe(std::vector<epoch_bag> &bags)
+	{
+		const uint64_t epoch = globalEpoch.load(std::memory_order_seq_cst);
+
+		size_type released = 0;
+		auto safeEnd = bags.begin();
+		for (; safeEnd != bags.end() && safeEnd->epoch + 2 <= epoch; ++safeEnd)
+		{
+			released += safeEnd->regions.size();
+			for (const region &target : safeEnd->regions)
+				resourcePool.release(target);
+		}
+
+		bags.erase(bags.begin(), safeEnd);
+		return released;
+	}
+
+	PoolT &resourcePool;
+	std::atomic<uint64_t> globalEpoch = 0;
+
+	std::mutex participantMutex;
+	std::vector<participant_record *> participants;
+	std::vector<epoch_bag> orphans;
+};
+
+} // namespace memory
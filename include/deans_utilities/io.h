@@ -0,0 +1,373 @@
+#pragma once
+#include "util/memory.h"
+#include <cerrno>
+#include <climits>
+#include <memory>
+#include <system_error>
+#include <sys/uio.h>
+#include <unistd.h>
+
+#if __has_include(<liburing.h>)
+#include <liburing.h>
+#define MEMORY_HAS_LIBURING 1
+#endif
+
+namespace memory
+{
+/**
+ * @brief Describe regions as an iovec array, without copying them
+ *
+ * @param regions Regions to describe
+ * @param dest Destination for the iovecs, they are appended
+ */
+inline void to_iovecs(std::span<const region> regions, std::vector<iovec> &dest)
+{
+	dest.reserve(dest.size() + regions.size());
+	for (const region &target : regions)
+		dest.push_back(iovec{target.startPtr, target.size()});
+}
+
+/**
+ * @brief Write regions to a file descriptor with writev, without concatenating them
+ *
+ * Short writes and interrupted calls are retried until everything is written
+ *
+ * @param fd File descriptor to write to
+ * @param regions Regions to write, in order
+ * @return std::size_t Number of bytes written
+ *
+ * @throws std::system_error if writev fails
+ */
+inline std::size_t gather_write(int fd, std::span<const region> regions)
+{
+	// Submitted in batches from the stack so writing never allocates
+	constexpr std::size_t batch_size = std::min<std::size_t>(64, IOV_MAX);
+
+	std::size_t totalWritten = 0;
+	std::size_t next = 0;
+	std::size_t offset = 0; // bytes already written from regions[next]
+
+	while (next < regions.size())
+	{
+		iovec batch[batch_size];
+		std::size_t count = 0;
+
+		for (std::size_t i = next; i < regions.size() && count < batch_size; ++i, ++count)
+		{
+			const std::size_t skip = i == next ? offset : 0;
+			batch[count] = iovec{regions[i].startPtr + skip, regions[i].size() - skip};
+		}
+
+		const ssize_t written = writev(fd, batch, count);
+		if (written < 0)
+		{
+			if (errno == EINTR)
+				continue;
+			throw std::system_error(errno, std::generic_category(), "writev failed");
+		}
+
+		totalWritten += written;
+
+		// Advance past fully written regions
+		std::size_t remaining = written;
+		while (next < regions.size() && remaining >= regions[next].size() - offset)
+		{
+			remaining -= regions[next].size() - offset;
+			offset = 0;
+			++next;
+		}
+		offset += remaining;
+	}
+
+	return totalWritten;
+}
+
+/**
+ * @brief Write everything written to a chained writer, then release its regions back to the pool
+ *
+ * @param fd File descriptor to write to
+ * @param source Chained writer holding the data
+ * @return std::size_t Number of bytes written
+ *
+ * @throws std::system_error if writev fails, the regions are kept by source
+ */
+template <typename PoolT>
+std::size_t gather_write(int fd, ranges::writer<PoolT> &source)
+{
+	const std::size_t written = gather_write(fd, source.filled());
+	source.release();
+	return written;
+}
+
+#ifdef MEMORY_HAS_LIBURING
+/**
+ * @brief Asynchronous scatter list submission with io_uring
+ *
+ * Regions inside registered buffers are written with fixed buffer writes, so the kernel doesn't map them
+ * on every submission. The regions of a submission are released to the pool once all its writes complete.
+ *
+ * @tparam PoolT Pool the submitted regions are released to
+ */
+template <typename PoolT = resource_pool>
+struct uring_writer
+{
+	/**
+	 * @brief Constructor
+	 *
+	 * @param resourcePool Pool to release completed regions to, must outlive the writer
+	 * @param entries Submission queue size
+	 *
+	 * @throws std::system_error if the ring cannot be created
+	 */
+	uring_writer(PoolT &resourcePool, unsigned entries = 64)
+		: resourcePool(resourcePool), queueEntries(entries)
+	{
+		if (const int result = io_uring_queue_init(entries, &ring, 0); result < 0)
+			throw std::system_error(-result, std::generic_category(), "io_uring_queue_init failed");
+	}
+
+	uring_writer(const uring_writer &) = delete;
+	uring_writer &operator=(const uring_writer &) = delete;
+
+	/*! @brief Deconstructor, waits for outstanding writes and releases their regions */
+	~uring_writer()
+	{
+		while (!submissions.empty() && reap(true))
+			;
+		io_uring_queue_exit(&ring);
+	}
+
+	/**
+	 * @brief Register buffers, eg the slabs of the pool, for fixed buffer writes
+	 *
+	 * A ring holds a single buffer table, so buffers registered by earlier calls are registered again together with
+	 * the new ones, keeping their indices
+	 *
+	 * @param buffers Range of regions, or of resources convertible to regions
+	 *
+	 * @throws std::system_error if the buffers cannot be registered, the previously registered buffers are kept
+	 */
+	void register_buffers(const auto &buffers)
+	{
+		std::vector<region> table = registered;
+		for (const auto &buffer : buffers)
+			table.push_back(region(buffer));
+
+		if (table.size() == registered.size())
+			return;
+
+		if (!registered.empty())
+			if (const int result = io_uring_unregister_buffers(&ring); result < 0)
+				throw std::system_error(-result, std::generic_category(), "io_uring_unregister_buffers failed");
+
+		if (const int result = register_table(table); result < 0)
+		{
+			// Put the old table back, if even that fails nothing is registered and writes fall back to unregistered ones
+			if (!registered.empty() && register_table(registered) < 0)
+				registered.clear();
+			throw std::system_error(-result, std::generic_category(), "io_uring_register_buffers failed");
+		}
+
+		registered = std::move(table);
+	}
+
+	/**
+	 * @brief Submit linked writes of a scatter list, the regions are released to the pool on completion
+	 *
+	 * @param fd File descriptor to write to
+	 * @param filled Data to write, in order
+	 * @param owned Regions to release to the pool once all writes complete
+	 * @param offset File offset of the first write, -1 writes at the current file position
+	 *
+	 * @throws std::system_error if a previous completion failed
+	 */
+	void submit(int fd, std::span<const region> filled, std::vector<region> &&owned, int64_t offset = -1)
+	{
+		submissions.push_back(std::make_unique<submission>(std::move(owned)));
+		submission *batch = submissions.back().get();
+		batch->operations.reserve(filled.size());
+
+		if (filled.empty())
+		{
+			complete(batch);
+			return;
+		}
+
+		const std::size_t maxChain = queueEntries;
+
+		for (std::size_t chainStart = 0; chainStart < filled.size(); chainStart += maxChain)
+		{
+			const std::size_t chainEnd = std::min(filled.size(), chainStart + maxChain);
+
+			// A link chain must be submitted at once, so make room for all of it first
+			while (io_uring_sq_space_left(&ring) < chainEnd - chainStart)
+			{
+				io_uring_submit(&ring);
+				reap(true);
+			}
+
+			for (std::size_t i = chainStart; i < chainEnd; ++i)
+			{
+				const region &target = filled[i];
+				io_uring_sqe *sqe = io_uring_get_sqe(&ring);
+
+				if (const int index = registered_index(target); index >= 0)
+					io_uring_prep_write_fixed(sqe, fd, target.startPtr, target.size(), offset, index);
+				else
+					io_uring_prep_write(sqe, fd, target.startPtr, target.size(), offset);
+
+				// Linked so stream file descriptors see the regions in order, later chains drain the earlier ones
+				unsigned flags = 0;
+				if (i + 1 != chainEnd)
+					flags |= IOSQE_IO_LINK;
+				if (i == chainStart && chainStart != 0)
+					flags |= IOSQE_IO_DRAIN;
+				io_uring_sqe_set_flags(sqe, flags);
+
+				io_uring_sqe_set_data(sqe, &batch->operations.emplace_back(batch, target.size()));
+
+				if (offset >= 0)
+					offset += target.size();
+			}
+		}
+
+		io_uring_submit(&ring);
+		throw_pending_error();
+	}
+
+	/**
+	 * @brief Submit everything written to a chained writer, its regions are moved to this writer and released on completion
+	 *
+	 * @param fd File descriptor to write to
+	 * @param source Chained writer holding the data, it is empty afterwards
+	 * @param offset File offset of the first write, -1 writes at the current file position
+	 */
+	void submit(int fd, ranges::writer<PoolT> &source, int64_t offset = -1)
+	{
+		const std::vector<region> filled = source.filled();
+		submit(fd, filled, source.detach(), offset);
+	}
+
+	/**
+	 * @brief Process finished writes without blocking
+	 *
+	 * A short write breaks its link chain, so it is reported as EIO
+	 *
+	 * @throws std::system_error if a write failed or was short
+	 */
+	void poll()
+	{
+		while (reap(false))
+			;
+		throw_pending_error();
+	}
+
+	/**
+	 * @brief Wait for all submitted writes to finish
+	 *
+	 * @throws std::system_error if a write failed or was short
+	 */
+	void wait()
+	{
+		while (!submissions.empty() && reap(true))
+			;
+		throw_pending_error();
+	}
+
+  private:
+	struct submission;
+
+	/*! @brief A single write, the user data of its submission queue entry */
+	struct operation
+	{
+		submission *batch;
+		std::size_t length;
+	};
+
+	struct submission
+	{
+		submission(std::vector<region> &&owned)
+			: owned(std::move(owned))
+		{
+		}
+
+		std::vector<region> owned;
+		std::vector<operation> operations;
+		std::size_t completed = 0;
+	};
+
+	int register_table(const std::vector<region> &table)
+	{
+		std::vector<iovec> iovecs;
+		to_iovecs(table, iovecs);
+		return io_uring_register_buffers(&ring, iovecs.data(), iovecs.size());
+	}
+
+	/*! @brief Get the registered buffer index containing target, or -1 */
+	int registered_index(const region &target) const
+	{
+		for (std::size_t i = 0; i < registered.size(); ++i)
+			if (registered[i].startPtr <= target.startPtr && target.endPtr <= registered[i].endPtr)
+				return i;
+		return -1;
+	}
+
+	/**
+	 * @brief Process one completion
+	 *
+	 * @param block Wait for a completion if none is ready
+	 * @return true if a completion was processed
+	 */
+	bool reap(bool block)
+	{
+		io_uring_cqe *cqe = nullptr;
+		const int result = block ? io_uring_wait_cqe(&ring, &cqe) : io_uring_peek_cqe(&ring, &cqe);
+		if (result < 0 || !cqe)
+		{
+			if (block && result != -EAGAIN && result != -EINTR)
+				pendingError = -result;
+			return false;
+		}
+
+		const operation *write = static_cast<const operation *>(io_uring_cqe_get_data(cqe));
+		if (!pendingError && cqe->res < 0)
+			pendingError = -cqe->res;
+		else if (!pendingError && std::size_t(cqe->res) != write->length)
+			pendingError = EIO;
+		io_uring_cqe_seen(&ring, cqe);
+
+		submission *batch = write->batch;
+		if (++batch->completed == batch->operations.size())
+			complete(batch);
+
+		return true;
+	}
+
+	/*! @brief Release the regions of a finished submission */
+	void complete(submission *batch)
+	{
+		for (const region &target : batch->owned)
+			resourcePool.release(target);
+
+		std::erase_if(submissions, [batch](const std::unique_ptr<submission> &other) { return other.get() == batch; });
+	}
+
+	void throw_pending_error()
+	{
+		if (const int error = pendingError)
+		{
+			pendingError = 0;
+			throw std::system_error(error, std::generic_category(), "io_uring write failed");
+		}
+	}
+
+	PoolT &resourcePool;
+	unsigned queueEntries;
+	io_uring ring;
+	std::vector<region> registered;
+	std::vector<std::unique_ptr<submission>> submissions;
+	int pendingError = 0;
+};
+#endif
+
+} // namespace memory
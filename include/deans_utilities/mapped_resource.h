@@ -0,0 +1,244 @@
+#pragma once
+#include "util/memory.h"
+#include <cerrno>
+#include <system_error>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace memory
+{
+/**
+ * @brief How a file is mapped
+ *
+ */
+enum class map_mode : uint8_t
+{
+	/*! @brief Read only, shared with the page cache */
+	read_only,
+	/*! @brief Read and write, writes go to the file */
+	read_write,
+	/*! @brief Read and write, writes are private copies and never reach the file */
+	copy_on_write
+};
+
+/**
+ * @brief Access pattern hints for a mapping, they can be combined
+ *
+ */
+enum class map_advice : uint8_t
+{
+	none = 0,
+	/*! @brief Pages are read in order, read ahead aggressively and drop pages behind */
+	sequential = 1 << 0,
+	/*! @brief Pages are read in random order, don't read ahead */
+	random = 1 << 1,
+	/*! @brief Pages will be needed soon, start reading them in */
+	will_need = 1 << 2,
+	/*! @brief Back the mapping with transparent huge pages where the file system supports it */
+	huge_page = 1 << 3,
+	/*! @brief Prefault the whole mapping when it is created, with MAP_POPULATE */
+	populate = 1 << 4
+};
+
+constexpr map_advice operator|(map_advice a, map_advice b)
+{
+	return map_advice(uint8_t(a) | uint8_t(b));
+}
+
+constexpr bool operator&(map_advice a, map_advice b)
+{
+	return (uint8_t(a) & uint8_t(b)) != 0;
+}
+
+/**
+ * @brief A memory mapped file
+ *
+ * Exposes a file as a region, so writers, readers and pools can operate on it without copying it into a resource
+ */
+struct mapped_resource
+{
+	/*! @brief unsigned integer type*/
+	using size_type = std::size_t;
+
+	/*! @brief Non-mapping default constructor*/
+	mapped_resource() = default;
+
+	/**
+	 * @brief Map a whole file
+	 *
+	 * @param path Path of the file
+	 * @param mode How the file is mapped
+	 * @param advice Access pattern hints
+	 *
+	 * @throws std::system_error if the file cannot be opened or mapped
+	 */
+	mapped_resource(const char *path, map_mode mode = map_mode::read_only, map_advice advice = map_advice::none)
+	{
+		const int fd = open(path, mode == map_mode::read_write ? O_RDWR : O_RDONLY);
+		if (fd < 0)
+			throw std::system_error(errno, std::generic_category(), "Failed to open mapped file");
+
+		struct stat info;
+		if (fstat(fd, &info) != 0)
+		{
+			const int error = errno;
+			close(fd);
+			throw std::system_error(error, std::generic_category(), "Failed to stat mapped file");
+		}
+
+		try
+		{
+			map(fd, info.st_size, 0, mode, advice);
+		}
+		catch (...)
+		{
+			close(fd);
+			throw;
+		}
+
+		// The mapping keeps the file alive
+		close(fd);
+	}
+
+	/**
+	 * @brief Map part of an open file
+	 *
+	 * @param fd File descriptor, it can be closed once the constructor returns
+	 * @param size Size of the mapping in bytes
+	 * @param offset Offset in the file, a multiple of the page size
+	 * @param mode How the file is mapped, must match how fd was opened
+	 * @param advice Access pattern hints
+	 *
+	 * @throws std::system_error if the file cannot be mapped
+	 */
+	mapped_resource(int fd, size_type size, off_t offset = 0, map_mode mode = map_mode::read_only, map_advice advice = map_advice::none)
+	{
+		map(fd, size, offset, mode, advice);
+	}
+
+	/*! @brief Move constructor */
+	mapped_resource(mapped_resource &&other) noexcept
+		: ptr(other.ptr), size(other.size)
+	{
+		other.ptr = nullptr;
+		other.size = 0;
+	}
+
+	/*! @brief Deleted copy constructor, delete to avoid double unmap */
+	mapped_resource(const mapped_resource &other) = delete;
+
+	/*! @brief Copy assignment operator, delete to avoid double unmap*/
+	mapped_resource &operator=(const mapped_resource &other) = delete;
+
+	/*! @brief Move Assignment, unmaps previous contents if necessary */
+	mapped_resource &operator=(mapped_resource &&other) noexcept
+	{
+		unmap();
+
+		ptr = other.ptr;
+		size = other.size;
+
+		other.ptr = nullptr;
+		other.size = 0;
+
+		return *this;
+	}
+
+	/*! @brief Deconstructor*/
+	~mapped_resource()
+	{
+		unmap();
+	}
+
+	/*! @brief Get a handle for the region*/
+	inline operator region() const
+	{
+		return region(ptr, ptr + size);
+	}
+
+	/**
+	 * @brief Get a pointer to the mapping
+	 */
+	inline uint8_t *get_pointer() const
+	{
+		return ptr;
+	}
+
+	/**
+	 * @brief Get the size of the mapping in bytes
+	 */
+	inline size_type get_size() const
+	{
+		return size;
+	}
+
+	/**
+	 * @brief Apply access pattern hints to part of the mapping
+	 *
+	 * @param target Region of the mapping, it is widened to whole pages
+	 * @param advice Access pattern hints, populate is ignored
+	 */
+	void advise(region target, map_advice advice) const
+	{
+		uint8_t *start = ptr + ((target.startPtr - ptr) & ~(page_size - 1));
+		const size_type length = target.endPtr - start;
+
+		if (advice & map_advice::sequential)
+			madvise(start, length, MADV_SEQUENTIAL);
+		if (advice & map_advice::random)
+			madvise(start, length, MADV_RANDOM);
+		if (advice & map_advice::will_need)
+			madvise(start, length, MADV_WILLNEED);
+#ifdef MADV_HUGEPAGE
+		if (advice & map_advice::huge_page)
+			madvise(start, length, MADV_HUGEPAGE);
+#endif
+	}
+
+	/**
+	 * @brief Flush written pages of a read_write mapping to the file
+	 *
+	 * @throws std::system_error if the pages cannot be flushed
+	 */
+	void sync() const
+	{
+		if (ptr && msync(ptr, size, MS_SYNC) != 0)
+			throw std::system_error(errno, std::generic_category(), "Failed to sync mapped file");
+	}
+
+  private:
+	void map(int fd, size_type mapSize, off_t offset, map_mode mode, map_advice advice)
+	{
+		if (mapSize == 0)
+			return;
+
+		const int protection = mode == map_mode::read_only ? PROT_READ : PROT_READ | PROT_WRITE;
+		int flags = mode == map_mode::copy_on_write ? MAP_PRIVATE : MAP_SHARED;
+#ifdef MAP_POPULATE
+		if (advice & map_advice::populate)
+			flags |= MAP_POPULATE;
+#endif
+
+		void *mapping = mmap(nullptr, mapSize, protection, flags, fd, offset);
+		if (mapping == MAP_FAILED)
+			throw std::system_error(errno, std::generic_category(), "Failed to map file");
+
+		ptr = static_cast<uint8_t *>(mapping);
+		size = mapSize;
+
+		advise(*this, advice);
+	}
+
+	void unmap()
+	{
+		if (ptr)
+			munmap(ptr, size);
+	}
+
+	uint8_t *ptr = nullptr;
+	size_type size = 0;
+};
+
+} // namespace memory
@@ -1,11 +1,58 @@
 #pragma once
 #include "stdint.h"
 #include "util/ranges.h"
+#include "util/statistics.h"
+#include "util/stream_copy.h"
+#include <algorithm>
+#include <array>
+#include <bit>
 #include <cassert>
+#include <cerrno>
+#include <concepts>
 #include <cstring>
+#include <mutex>
+#include <new>
+#include <optional>
+#include <span>
 #include <stdexcept>
+#include <string>
+#include <system_error>
+#include <type_traits>
 #include <vector>
 
+#if __has_include(<sys/mman.h>)
+#include <sys/mman.h>
+#define MEMORY_HAS_MMAN 1
+#endif
+
+#if defined(__SANITIZE_ADDRESS__)
+#define MEMORY_HAS_ASAN 1
+#elif defined(__has_feature)
+#if __has_feature(address_sanitizer)
+#define MEMORY_HAS_ASAN 1
+#endif
+#endif
+
+#ifdef MEMORY_HAS_ASAN
+#include <sanitizer/asan_interface.h>
+#endif
+
+#ifndef MEMORY_DEBUG_POOLS
+/**
+ * @brief Set to 1 so pools track acquired regions, assert on bad releases and poison released memory
+ *
+ * This changes the layout of the pools, so it must have the same value in every translation unit of a program,
+ * eg set it through the MEMORY_UTILITIES_DEBUG_POOLS CMake option rather than per file
+ */
+#define MEMORY_DEBUG_POOLS 0
+#endif
+
+#if defined(__linux__) && defined(MEMORY_HAS_MMAN)
+#include <sys/syscall.h>
+#include <unistd.h>
+#define MEMORY_HAS_NUMA 1
+#endif
+
 namespace memory
 {
 /*
@@ -25,6 +72,56 @@ inline std::size_t aligned_size(std::size_t size, std::size_t alignment)
 	return ((size + (alignment - 1)) & ~(alignment - 1));
 }
 
+/*! @brief Size of a cache line, the smallest alignment that avoids false sharing */
+constexpr std::size_t cache_line_size = 64;
+
+/*! @brief Size of a standard page */
+constexpr std::size_t page_size = 4096;
+
+/*! @brief Size of a huge page */
+constexpr std::size_t huge_page_size = 2 << 20;
+
+/**
+ * @brief Reverse the byte order of an object
+ *
+ * @tparam ObjectT A trivially copyable type, eg an integer, float or enum
+ * @param value Object to swap
+ * @return ObjectT The object with its bytes in reverse order
+ */
+template <typename ObjectT>
+constexpr ObjectT byteswap(ObjectT value)
+{
+	static_assert(std::is_trivially_copyable_v<ObjectT>, "Only trivially copyable objects can be byte swapped");
+
+	auto bytes = std::bit_cast<std::array<std::byte, sizeof(ObjectT)>>(value);
+	std::reverse(bytes.begin(), bytes.end());
+	return std::bit_cast<ObjectT>(bytes);
+}
+
+/**
+ * @brief Convert between native and little endian byte order
+ */
+template <typename ObjectT>
+constexpr ObjectT to_little_endian(ObjectT value)
+{
+	if constexpr (std::endian::native == std::endian::little)
+		return value;
+	else
+		return byteswap(value);
+}
+
+/**
+ * @brief Convert between native and big endian byte order
+ */
+template <typename ObjectT>
+constexpr ObjectT to_big_endian(ObjectT value)
+{
+	if constexpr (std::endian::native == std::endian::big)
+		return value;
+	else
+		return byteswap(value);
+}
+
 // Common class for memory operations
 struct region
 {
@@ -36,7 +133,7 @@ struct region
 	{
 	}
 
-	region(uint8_t *start, uint32_t size)
+	region(uint8_t *start, std::size_t size)
 		: region(start, start + size)
 	{
 	}
@@ -74,12 +171,115 @@ struct region
 	uint8_t *startPtr;
 	uint8_t *endPtr;
 
-	inline uint32_t size() const
+	inline std::size_t size() const
 	{
 		return endPtr - startPtr;
 	}
 };
 
+/**
+ * @brief A compact region, stored as a 32 bit offset and size relative to a base address
+ *
+ * Half the size of a region, for index structures holding many regions of the same arena or slab
+ */
+struct region32
+{
+	region32()
+		: offset(0), length(0) {}
+
+	region32(uint32_t offset, uint32_t length)
+		: offset(offset), length(length)
+	{
+	}
+
+	/**
+	 * @brief Compress a region
+	 *
+	 * @param base Base address the offset is relative to
+	 * @param target Region starting at or after base, ending within 4 GiB of base
+	 */
+	static region32 from(const uint8_t *base, const region &target)
+	{
+		assert(target.startPtr >= base && "Region starts before its base address");
+		assert(std::size_t(target.endPtr - base) <= UINT32_MAX && "Region ends too far from its base address for a region32");
+
+		return region32(target.startPtr - base, target.size());
+	}
+
+	/**
+	 * @brief Expand to a region
+	 *
+	 * @param base Base address the offset is relative to
+	 */
+	region to_region(uint8_t *base) const
+	{
+		return region(base + offset, base + offset + length);
+	}
+
+	inline uint32_t size() const
+	{
+		return length;
+	}
+
+	uint32_t offset;
+	uint32_t length;
+};
+
+namespace unsafe
+{
+	/**
+	 * @brief This is an unsafe memory writer, please avoid using it
+	 * Internally it is just a wrapper for a pointer,
+	 */
+	struct writer
+	{
+		writer()
+			: writeDest(nullptr) {}
+
+		writer(uint8_t *start)
+			: writeDest(start)
+		{
+		}
+
+		/*! @brief Check if writer is valid*/
+		explicit operator bool() const { return writeDest; }
+
+		/*! @brief write to the pointer and advance it*/
+		void write(const void *src, std::size_t amount)
+		{
+			memcpy(writeDest, src, amount);
+			writeDest += amount;
+		}
+
+		/*! @brief write an object to the pointer and advance it*/
+		template <typename ObjectT>
+		void write(const ObjectT &object)
+		{
+			memcpy(writeDest, &object, sizeof(ObjectT));
+			writeDest += sizeof(ObjectT);
+		}
+
+		/*! @brief Write a string to the pointer and advance it*/
+		void write_str(const char *src, std::size_t amount)
+		{
+			std::strncpy((char *)writeDest, src, amount);
+			writeDest += amount;
+		}
+		/**
+		 * @brief Get a pointer to where this writer is pointing to
+		 *
+		 */
+		uint8_t *get_pointer() const
+		{
+			return writeDest;
+		}
+
+	  private:
+		uint8_t *writeDest = nullptr;
+	};
+
+} // namespace unsafe
+
 /**
  * @brief Common functions for memory safe writer objects
  *
@@ -116,6 +316,57 @@ struct writer_base
 
 			return true;
 		}
+		detail::writer_counters::on_failure(amount);
+		return false;
+	}
+
+	/**
+	 * @brief write an object to underlying memory address, the copy has a compile time size so it becomes a direct store
+	 *
+	 * @param bufferEnd Ending address for this buffer
+	 * @param object Object to be written
+	 * @return true if data was written
+	 * @return false if buffer is out of space and no data was written
+	 */
+	template <typename ObjectT>
+	inline bool write_object(uint8_t *bufferEnd, const ObjectT &object)
+	{
+		static_assert(std::is_trivially_copyable_v<ObjectT>, "Only trivially copyable objects can be written");
+
+		if (sizeof(ObjectT) <= bytes_remaining(bufferEnd))
+		{
+			memcpy(writeStart, &object, sizeof(ObjectT));
+			writeStart += sizeof(ObjectT);
+
+			return true;
+		}
+		detail::writer_counters::on_failure(sizeof(ObjectT));
+		return false;
+	}
+
+	/**
+	 * @brief write to underlying memory address, bypassing the cache for large writes
+	 *
+	 * @param bufferEnd Ending address for this buffer
+	 * @param src Memory address containing data to be written
+	 * @param amount Size of data to be written, non temporal stores are used from streaming_threshold
+	 * @return true if data was written
+	 * @return false if buffer is out of space and no data was written
+	 */
+	inline bool write_streaming(uint8_t *bufferEnd, const void *src, size_type amount)
+	{
+		uint8_t *writeEnd = writeStart + amount;
+		if (writeEnd <= bufferEnd)
+		{
+			if (amount >= streaming_threshold)
+				stream_copy(writeStart, src, amount);
+			else
+				memcpy(writeStart, src, amount);
+			writeStart = writeEnd;
+
+			return true;
+		}
+		detail::writer_counters::on_failure(amount);
 		return false;
 	}
 
@@ -130,6 +381,49 @@ struct writer_base
 		return bufferEnd - writeStart;
 	}
 
+	/**
+	 * @brief Reserve aligned, unwritten storage on the underlying memory address
+	 *
+	 * @param bufferEnd Ending address for this buffer
+	 * @param amount Size of the storage
+	 * @param alignment Alignment of the storage, a power of two
+	 * @return void* Start of the storage, or nullptr if the buffer is out of space and nothing was reserved
+	 */
+	inline void *allocate(uint8_t *bufferEnd, size_type amount, size_type alignment)
+	{
+		const size_type padding = aligned_size(reinterpret_cast<std::size_t>(writeStart), alignment) - reinterpret_cast<std::size_t>(writeStart);
+		if (padding + amount <= bytes_remaining(bufferEnd))
+		{
+			uint8_t *storage = writeStart + padding;
+			writeStart = storage + amount;
+
+			return storage;
+		}
+		detail::writer_counters::on_failure(amount);
+		return nullptr;
+	}
+
+	/**
+	 * @brief Reserve unwritten storage on the underlying memory address
+	 *
+	 * @param bufferEnd Ending address for this buffer
+	 * @param amount Size of the storage
+	 * @return uint8_t* Start of the storage, or nullptr if the buffer is out of space and nothing was reserved
+	 */
+	inline uint8_t *reserve(uint8_t *bufferEnd, size_type amount)
+	{
+		uint8_t *writeEnd = writeStart + amount;
+		if (writeEnd <= bufferEnd)
+		{
+			uint8_t *storage = writeStart;
+			writeStart = writeEnd;
+
+			return storage;
+		}
+		detail::writer_counters::on_failure(amount);
+		return nullptr;
+	}
+
   protected:
 	uint8_t *writeStart = nullptr;
 };
@@ -175,6 +469,21 @@ struct writer : public region, private writer_base
 		return writer_base::write(region::endPtr, src, amount);
 	}
 
+	/**
+	 * @brief Write data to buffer, large writes use non temporal stores so the destination isn't pulled into cache
+	 *
+	 * Use this for blobs that are only read back by the gpu, the region should be 64 byte aligned
+	 *
+	 * @param src Pointer to start of data
+	 * @param amount Number of bytes to write
+	 * @return true if data was written
+	 * @return false if buffer is out of space and no data was written
+	 */
+	bool write_streaming(const void *src, size_type amount)
+	{
+		return writer_base::write_streaming(region::endPtr, src, amount);
+	}
+
 	/**
 	 * @brief Write an object to the buffer
 	 *
@@ -186,7 +495,35 @@ struct writer : public region, private writer_base
 	template <typename ObjectT>
 	bool write(const ObjectT &object)
 	{
-		return writer_base::write(region::endPtr, &object, sizeof(ObjectT));
+		return writer_base::write_object(region::endPtr, object);
+	}
+
+	/**
+	 * @brief Write an object to the buffer in little endian byte order
+	 *
+	 * @tparam ObjectT Object type
+	 * @param object Object to write
+	 * @return true if data was written
+	 * @return false if buffer is out of space and no data was written
+	 */
+	template <typename ObjectT>
+	bool write_le(const ObjectT &object)
+	{
+		return writer_base::write_object(region::endPtr, to_little_endian(object));
+	}
+
+	/**
+	 * @brief Write an object to the buffer in big endian byte order
+	 *
+	 * @tparam ObjectT Object type
+	 * @param object Object to write
+	 * @return true if data was written
+	 * @return false if buffer is out of space and no data was written
+	 */
+	template <typename ObjectT>
+	bool write_be(const ObjectT &object)
+	{
+		return writer_base::write_object(region::endPtr, to_big_endian(object));
 	}
 
 	/**
@@ -198,9 +535,10 @@ struct writer : public region, private writer_base
 	 * @return false if buffer is out of space and no data was written
 	 */
 	template <typename RangeT>
-	bool write(const RangeT &&range) requires std::ranges::contiguous_range<RangeT> && std::ranges::sized_range<RangeT>
+	bool write(const RangeT &range) requires std::ranges::contiguous_range<RangeT> && std::ranges::sized_range<RangeT>
 	{
-		return writer_base::write(region::endPtr, range.data(), range.size() * sizeof(typename RangeT::value_type));
+		static_assert(std::is_trivially_copyable_v<std::ranges::range_value_t<RangeT>>, "Only ranges of trivially copyable objects can be written");
+		return writer_base::write(region::endPtr, std::ranges::data(range), std::ranges::size(range) * sizeof(std::ranges::range_value_t<RangeT>));
 	}
 
 	/**
@@ -223,6 +561,54 @@ struct writer : public region, private writer_base
 		return writer_base::writeStart - region::startPtr;
 	}
 
+	/**
+	 * @brief Write several objects with a single bounds check
+	 *
+	 * @tparam ObjectTs Object types
+	 * @param objects Objects to write, packed in order
+	 * @return true if data was written
+	 * @return false if buffer is out of space and no data was written
+	 */
+	template <typename... ObjectTs>
+	bool write_fields(const ObjectTs &...objects) requires(sizeof...(ObjectTs) > 0)
+	{
+		static_assert((std::is_trivially_copyable_v<ObjectTs> && ...), "Only trivially copyable objects can be written");
+
+		constexpr size_type amount = (sizeof(ObjectTs) + ...);
+
+		uint8_t *storage = writer_base::reserve(region::endPtr, amount);
+		if (!storage)
+			return false;
+
+		((memcpy(storage, &objects, sizeof(ObjectTs)), storage += sizeof(ObjectTs)), ...);
+		return true;
+	}
+
+	/**
+	 * @brief Reserve space with a single bounds check, to be filled without further checks
+	 *
+	 * @param amount Number of bytes to reserve
+	 * @return unsafe::writer Writer over the reserved space, invalid if the buffer is out of space and nothing was reserved
+	 *
+	 * @warning The returned writer is unchecked, writing more than amount bytes to it overflows the reservation
+	 */
+	unsafe::writer reserve(size_type amount)
+	{
+		return unsafe::writer(writer_base::reserve(region::endPtr, amount));
+	}
+
+	/**
+	 * @brief Reserve aligned storage in the buffer without writing to it
+	 *
+	 * @param amount Number of bytes to reserve
+	 * @param alignment Alignment of the storage, a power of two
+	 * @return void* Start of the storage, or nullptr if the buffer is out of space and nothing was reserved
+	 */
+	void *allocate(size_type amount, size_type alignment)
+	{
+		return writer_base::allocate(region::endPtr, amount, alignment);
+	}
+
 	/**
 	 * @brief Reset writer, ie set write start to start of region
 	 *
@@ -257,7 +643,7 @@ struct small_writer : private writer_base
 	 * @return true if data was written
 	 * @return false if buffer is out of space and no data was written
 	 */
-	bool write(const void *src, const uint32_t amount)
+	bool write(const void *src, const size_type amount)
 	{
 		return writer_base::write(bufferEnd, src, amount);
 	}
@@ -273,7 +659,35 @@ struct small_writer : private writer_base
 	template <typename ObjectT>
 	bool write(const ObjectT &object)
 	{
-		return writer_base::write(region::endPtr, &object, sizeof(ObjectT));
+		return writer_base::write_object(bufferEnd, object);
+	}
+
+	/**
+	 * @brief Write an object to the buffer in little endian byte order
+	 *
+	 * @tparam ObjectT Object type
+	 * @param object Object to write
+	 * @return true if data was written
+	 * @return false if buffer is out of space and no data was written
+	 */
+	template <typename ObjectT>
+	bool write_le(const ObjectT &object)
+	{
+		return writer_base::write_object(bufferEnd, to_little_endian(object));
+	}
+
+	/**
+	 * @brief Write an object to the buffer in big endian byte order
+	 *
+	 * @tparam ObjectT Object type
+	 * @param object Object to write
+	 * @return true if data was written
+	 * @return false if buffer is out of space and no data was written
+	 */
+	template <typename ObjectT>
+	bool write_be(const ObjectT &object)
+	{
+		return writer_base::write_object(bufferEnd, to_big_endian(object));
 	}
 
 	/**
@@ -285,311 +699,2327 @@ struct small_writer : private writer_base
 	 * @return false if buffer is out of space and no data was written
 	 */
 	template <typename RangeT>
-	bool write(const RangeT &&range) requires std::ranges::contiguous_range<RangeT> && std::ranges::sized_range<RangeT>
+	bool write(const RangeT &range) requires std::ranges::contiguous_range<RangeT> && std::ranges::sized_range<RangeT>
 	{
-		return writer_base::write(region::endPtr, range.data(), range.size() * sizeof(typename RangeT::value_type));
+		static_assert(std::is_trivially_copyable_v<std::ranges::range_value_t<RangeT>>, "Only ranges of trivially copyable objects can be written");
+		return writer_base::write(bufferEnd, std::ranges::data(range), std::ranges::size(range) * sizeof(std::ranges::range_value_t<RangeT>));
 	}
 
 	/**
-	 * @brief Get number of bytes written to by this writer
+	 * @brief Get number of unwritten bytes on buffer
 	 *
-	 * @return size_type number of bytes written
+	 * @return size_type bytes available to be written
 	 */
-	bool bytes_remaining() const
+	size_type bytes_remaining() const
 	{
 		return writer_base::bytes_remaining(bufferEnd);
 	}
 
   private:
-	uint8_t *writeStart = nullptr;
 	uint8_t *bufferEnd = nullptr;
 };
 
-namespace unsafe
+/**
+ * @brief Common functions for memory safe reader objects
+ *
+ */
+struct reader_base
 {
+	using size_type = size_t;
 	/**
-	 * @brief This is an unsafe memory writer, please avoid using it
-	 * Internally it is just a wrapper for a pointer,
+	 * @brief Construct a new reader base object
+	 *
+	 * @param readerStart Memory address where reading will start
 	 */
-	struct writer
+	reader_base(uint8_t *readerStart)
+		: readStart(readerStart)
 	{
-		writer()
-			: writeDest(nullptr) {}
+	}
 
-		writer(uint8_t *start)
-			: writeDest(start)
+	/**
+	 * @brief read from underlying memory address
+	 *
+	 * @param bufferEnd Ending address for this buffer
+	 * @param dest Memory address the data is read into
+	 * @param amount Size of data to be read
+	 * @return true if data was read
+	 * @return false if buffer doesn't hold enough data and nothing was read
+	 */
+	inline bool read(const uint8_t *bufferEnd, void *dest, size_type amount)
+	{
+		uint8_t *readEnd = readStart + amount;
+		if (readEnd <= bufferEnd)
 		{
+			memcpy(dest, readStart, amount);
+			readStart = readEnd;
+
+			return true;
 		}
+		return false;
+	}
 
-		/*! @brief Check if writer is valid*/
-		explicit operator bool() const { return writeDest; }
+	/**
+	 * @brief read an object from underlying memory address, the copy has a compile time size so it becomes a direct load
+	 *
+	 * @param bufferEnd Ending address for this buffer
+	 * @param object Object the data is read into
+	 * @return true if data was read
+	 * @return false if buffer doesn't hold enough data and nothing was read
+	 */
+	template <typename ObjectT>
+	inline bool read_object(const uint8_t *bufferEnd, ObjectT &object)
+	{
+		static_assert(std::is_trivially_copyable_v<ObjectT>, "Only trivially copyable objects can be read");
 
-		/*! @brief write to the pointer and advance it*/
-		void write(const void *src, uint32_t amount)
+		if (sizeof(ObjectT) <= bytes_remaining(bufferEnd))
 		{
-			memcpy(writeDest, src, amount);
-			writeDest += amount;
+			memcpy(&object, readStart, sizeof(ObjectT));
+			readStart += sizeof(ObjectT);
+
+			return true;
 		}
+		return false;
+	}
 
-		/*! @brief Write a string to the pointer and advance it*/
-		void write_str(const char *src, uint32_t amount)
+	/**
+	 * @brief read from underlying memory address without advancing
+	 *
+	 * @param bufferEnd Ending address for this buffer
+	 * @param dest Memory address the data is read into
+	 * @param amount Size of data to be read
+	 * @return true if data was read
+	 * @return false if buffer doesn't hold enough data and nothing was read
+	 */
+	inline bool peek(const uint8_t *bufferEnd, void *dest, size_type amount) const
+	{
+		if (readStart + amount <= bufferEnd)
 		{
-			std::strncpy((char *)writeDest, src, amount);
-			writeDest += amount;
+			memcpy(dest, readStart, amount);
+			return true;
 		}
-		/**
-		 * @brief Get a pointer to where this writer is pointing to
-		 *
-		 */
-		uint8_t *get_pointer() const
+		return false;
+	}
+
+	/**
+	 * @brief Advance past data without reading it
+	 *
+	 * @param bufferEnd Ending address for this buffer
+	 * @param amount Number of bytes to skip
+	 * @return true if data was skipped
+	 * @return false if buffer doesn't hold enough data and nothing was skipped
+	 */
+	inline bool skip(const uint8_t *bufferEnd, size_type amount)
+	{
+		uint8_t *readEnd = readStart + amount;
+		if (readEnd <= bufferEnd)
 		{
-			return writeDest;
+			readStart = readEnd;
+			return true;
 		}
+		return false;
+	}
 
-	  private:
-		uint8_t *writeDest = nullptr;
+	/**
+	 * @brief Advance past data, returning it as a region without copying
+	 *
+	 * @param bufferEnd Ending address for this buffer
+	 * @param amount Number of bytes to view
+	 * @param output Region of the viewed data
+	 * @return true if data was viewed
+	 * @return false if buffer doesn't hold enough data, nothing was viewed and output is unchanged
+	 */
+	inline bool view(const uint8_t *bufferEnd, size_type amount, region &output)
+	{
+		uint8_t *readEnd = readStart + amount;
+		if (readEnd <= bufferEnd)
+		{
+			output = region(readStart, readEnd);
+			readStart = readEnd;
+			return true;
+		}
+		return false;
+	}
+
+	/**
+	 * @brief Get number of unread bytes on buffer
+	 *
+	 * @param bufferEnd Ending address for this buffer
+	 * @return size_type Number of unread bytes
+	 */
+	inline size_type bytes_remaining(const uint8_t *const bufferEnd) const
+	{
+		return bufferEnd - readStart;
+	}
+
+  protected:
+	uint8_t *readStart = nullptr;
+};
+
+namespace detail
+{
+	template <typename T>
+	struct is_span : std::false_type
+	{
 	};
 
-} // namespace unsafe
+	template <typename T, std::size_t Extent>
+	struct is_span<std::span<T, Extent>> : std::true_type
+	{
+	};
+} // namespace detail
 
 /**
- * @brief A memory block
+ * @brief A reader for a memory region, with implicit overflow protection
+ *
+ * This object makes a memory region readable, it is the counterpart of memory::writer
  *
  */
-struct resource
+struct reader : public region, private reader_base
 {
-	/*! @brief unsigned integer type*/
-	using size_type = std::size_t;
+	using size_type = size_t;
 
-	/*! @brief Non-allocating default constructor*/
-	resource()
-		: resource(nullptr, 0)
+	/**
+	 * @brief Construct an empty reader object
+	 *
+	 */
+	reader()
+		: region(), reader_base(nullptr) {}
+
+	/**
+	 * @brief Construct a new reader object
+	 *
+	 * @param source Region to read from
+	 */
+	reader(region source)
+		: region(source), reader_base(source.startPtr)
 	{
 	}
 
 	/**
-	 * @brief Allocate a region of specified size
+	 * @brief Read data from buffer
 	 *
-	 * @param size Size in bytes of the allocated region
+	 * @param dest Pointer to the destination
+	 * @param amount Number of bytes to read
+	 * @return true if data was read
+	 * @return false if buffer doesn't hold enough data and nothing was read
 	 */
-	resource(size_type size)
-		: resource(new uint8_t[size], size)
+	bool read(void *dest, size_type amount)
 	{
-		assert(size != 0);
+		return reader_base::read(region::endPtr, dest, amount);
 	}
 
-	/*! @brief Move constructor */
-	resource(resource &&other)
-		: resource(other.ptr, other.size)
+	/**
+	 * @brief Read an object from the buffer
+	 *
+	 * @tparam ObjectT Object type
+	 * @param object Object to read into
+	 * @return true if data was read
+	 * @return false if buffer doesn't hold enough data and nothing was read
+	 */
+	template <typename ObjectT>
+	bool read(ObjectT &object) requires(!detail::is_span<ObjectT>::value)
 	{
-		other.ptr = nullptr;
-		other.size = 0;
+		return reader_base::read_object(region::endPtr, object);
 	}
 
-	/*! @brief Deleted copy constructor, delete to avoid double free */
-	resource(const resource &other) = delete;
-
-	/*! @brief Copy assignment operator, delete to avoid double free*/
-	resource &operator=(const resource &other) = delete;
-
-	/*! @brief Move Assignment, deletes previous contents if necessary */
-	resource &operator=(resource &&other)
+	/**
+	 * @brief Read an object from the buffer
+	 *
+	 * @tparam ObjectT Object type
+	 * @return std::optional<ObjectT> The object, or empty if buffer doesn't hold enough data and nothing was read
+	 */
+	template <typename ObjectT>
+	std::optional<ObjectT> read()
 	{
-		if (ptr)
-			delete ptr;
-
-		ptr = other.ptr;
-		size = other.size;
-
-		other.ptr = nullptr;
-		other.size = 0;
-
-		return *this;
+		ObjectT object;
+		if (!reader_base::read_object(region::endPtr, object))
+			return std::nullopt;
+		return object;
 	}
 
-	/*! @brief Get a handle for the region*/
-	inline operator region() const
+	/**
+	 * @brief Read a little endian object from the buffer
+	 *
+	 * @tparam ObjectT Object type
+	 * @param object Object to read into, in native byte order
+	 * @return true if data was read
+	 * @return false if buffer doesn't hold enough data and nothing was read
+	 */
+	template <typename ObjectT>
+	bool read_le(ObjectT &object)
 	{
-		return region(ptr, ptr + size);
+		if (!reader_base::read_object(region::endPtr, object))
+			return false;
+		object = to_little_endian(object);
+		return true;
 	}
 
 	/**
-	 * @brief Get a handle for an unsafe memory writer, avoid using this
+	 * @brief Read a big endian object from the buffer
 	 *
-	 * This should only really be used with fixed size ranges, like string_array
-	 * @warning This is a memory unsafe function and probably shouldn't be used
+	 * @tparam ObjectT Object type
+	 * @param object Object to read into, in native byte order
+	 * @return true if data was read
+	 * @return false if buffer doesn't hold enough data and nothing was read
 	 */
-	inline operator unsafe::writer() const
+	template <typename ObjectT>
+	bool read_be(ObjectT &object)
 	{
-		return unsafe::writer(ptr);
+		if (!reader_base::read_object(region::endPtr, object))
+			return false;
+		object = to_big_endian(object);
+		return true;
 	}
 
-	/*! @brief Deconstructor*/
-	virtual ~resource()
+	/**
+	 * @brief Read a contigious range of objects from the buffer
+	 *
+	 * @param dest Objects to read into
+	 * @return true if data was read
+	 * @return false if buffer doesn't hold enough data and nothing was read
+	 */
+	template <typename ObjectT, std::size_t Extent>
+	bool read(std::span<ObjectT, Extent> dest)
 	{
-		if (ptr)
-			delete ptr;
+		return reader_base::read(region::endPtr, dest.data(), dest.size_bytes());
 	}
 
 	/**
-	 * @brief Get a pointer to the underlying memory block
+	 * @brief Read an object from the buffer without advancing
+	 *
+	 * @tparam ObjectT Object type
+	 * @param object Object to read into
+	 * @return true if data was read
+	 * @return false if buffer doesn't hold enough data and nothing was read
 	 */
-	inline uint8_t *get_pointer() const
+	template <typename ObjectT>
+	bool peek(ObjectT &object) const
 	{
-		return ptr;
+		return reader_base::peek(region::endPtr, &object, sizeof(ObjectT));
 	}
 
-  private:
-	/*! @brief Internal Constructor to help with member assignment */
-	resource(uint8_t *ptr, size_type size)
-		: ptr(ptr), size(size)
+	/**
+	 * @brief Advance past data without reading it
+	 *
+	 * @param amount Number of bytes to skip
+	 * @return true if data was skipped
+	 * @return false if buffer doesn't hold enough data and nothing was skipped
+	 */
+	bool skip(size_type amount)
 	{
+		return reader_base::skip(region::endPtr, amount);
 	}
 
-	uint8_t *ptr;
-	size_type size;
-};
-
-struct resource_allocator
-{
-	using value_type = resource;
-
 	/**
-	 * @brief Bulk allocate memory resources
+	 * @brief Advance past data, returning it as a sub region without copying
 	 *
-	 * @param resourceSize Resource Size in bytes
-	 * @param amount Number of resource to allocate
-	 * @param dest Destination range for those resources
+	 * @param amount Number of bytes to view
+	 * @param output Region of the viewed data
+	 * @return true if data was viewed
+	 * @return false if buffer doesn't hold enough data, nothing was viewed and output is unchanged
 	 */
-	void alloc_objects(uint32_t resourceSize, uint32_t amount, auto &&dest)
+	bool view(size_type amount, region &output)
 	{
-		const uint32_t oldRegionSize = regions.size();
-		regions.resize(regions.size() + amount);
-
-		auto newRegions = std::ranges::subrange(regions.begin() + oldRegionSize, regions.end());
+		return reader_base::view(region::endPtr, amount, output);
+	}
 
-		for (auto &element : newRegions)
-			element = std::move(resource(resourceSize));
+	/**
+	 * @brief Get number of unread bytes on buffer
+	 *
+	 * @return size_type bytes available to be read
+	 */
+	size_type bytes_remaining() const
+	{
+		return reader_base::bytes_remaining(region::endPtr);
+	}
 
-		ranges::append_range(dest, newRegions);
+	/**
+	 * @brief Get number of bytes read by this reader
+	 *
+	 * @return size_type number of bytes read
+	 */
+	size_type bytes_read() const
+	{
+		return reader_base::readStart - region::startPtr;
 	}
 
-  private:
-	std::vector<resource> regions;
+	/**
+	 * @brief Reset reader, ie set read start to start of region
+	 *
+	 */
+	void reset()
+	{
+		reader_base::readStart = region::startPtr;
+	}
 };
 
+
 /**
- * @brief A pool of memory allocations
+ * @brief Pages backing a resource
  *
- * It's primary purpose it to allow for quick access to cache memory to then copy to and from gpu
+ * Huge page modes are only honoured on platforms with mmap, otherwise they fall back to standard
+ */
+enum class page_mode : uint8_t
+{
+	/*! @brief Ordinary heap memory */
+	standard,
+	/*! @brief Anonymous mapping advised with MADV_HUGEPAGE, aligned to huge_page_size */
+	transparent_huge,
+	/*! @brief Anonymous mapping with MAP_HUGETLB, falls back to transparent_huge if no huge pages are reserved */
+	explicit_huge
+};
+
+/**
+ * @brief Allocation options for a resource
  *
- * @warning Releases all allocated regions on deconstruction
  */
-struct resource_pool
+struct resource_options
 {
-	/**
-	 * @brief Constructor
-	 * @param resourceSize The size of allocated regions, this should not be zero
-	 * @param allocationAmount Number of regions to allocate when empty, this should not be zero
-	 *
-	 * @warning Neither parameter should be zero
-	 */
-	resource_pool(uint32_t resourceSize, uint32_t allocationAmount = 1)
-		: resourceSize(resourceSize),
-		  allocationAmount(allocationAmount)
-	{
-		assert(resourceSize != 0 && "Resource size cannot be zero");
-		assert(allocationAmount != 0 && "Allocation amount cannot be zero");
+	/*! @brief Alignment of the start of the resource, must be a power of two */
+	std::size_t alignment = alignof(std::max_align_t);
+	/*! @brief Pages backing the resource */
+	page_mode pages = page_mode::standard;
+	/*! @brief Touch every page on allocation, so the first use doesn't page fault */
+	bool prefault = false;
+	/*! @brief NUMA node the pages are bound to, it must have memory, -1 leaves placement to the kernel */
+	int numaNode = -1;
+};
 
-		alloc_regions(allocationAmount);
+namespace detail
+{
+	/*! @brief Check if a resource is backed by an anonymous mapping rather than the heap */
+	inline bool is_mapped(const resource_options &options)
+	{
+#ifdef MEMORY_HAS_NUMA
+		// Binding heap memory would move neighbouring allocations too
+		if (options.numaNode >= 0)
+			return true;
+#endif
+		return options.pages != page_mode::standard;
 	}
 
-	/*! @brief Deconstructor, releases all allocated resources */
-	~resource_pool() {}
-
-	/*! @brief Acquire a region from the pool*/
-	region acquire()
+	/**
+	 * @brief Get the size of the mapping backing a resource
+	 *
+	 * @param size Requested size in bytes
+	 * @param options Resource options
+	 * @return std::size_t The size of the mapping, rounded up to a whole number of pages
+	 */
+	inline std::size_t mapped_size(std::size_t size, const resource_options &options)
 	{
-		if (available.empty())
-			alloc_regions(allocationAmount);
-
-		region output = available.back();
-		available.pop_back();
-		return output;
+		return aligned_size(size, options.pages == page_mode::standard ? page_size : huge_page_size);
 	}
 
 	/**
-	 * @brief Bulk acquire a number of regions
+	 * @brief Bind the pages of a mapping to a NUMA node with mbind, before they are faulted in
 	 *
-	 * @param count Number of regions needed
-	 * @return std::vector<region> acquired regions
+	 * Binding is best effort, on kernels without NUMA support the pages are placed by the kernel
 	 *
-	 * @todo Determine if copy to member available and then to regions has a performance impact
+	 * @param ptr Page aligned start of the mapping
+	 * @param size Size of the mapping in bytes
+	 * @param node NUMA node to bind to
+	 * @return true if the pages were bound
 	 */
-	std::vector<region> acquire(uint32_t count)
+	inline bool bind_to_node(uint8_t *ptr, std::size_t size, int node)
 	{
-		assert(count != 0 && "Cannot bulk acquire zero regions");
-
-		std::vector<region> regions(count);
+#ifdef MEMORY_HAS_NUMA
+		constexpr std::size_t mask_bits = 1024;
+		constexpr int bind_policy = 2; // MPOL_BIND
+		constexpr unsigned long bits_per_word = sizeof(unsigned long) * 8;
 
-		if (available.size() < count)
-			alloc_regions(allocationAmount + count - available.size());
-
-		const uint32_t copyStart = available.size() - count;
+		if (node < 0 || std::size_t(node) >= mask_bits)
+		{
+			errno = EINVAL;
+			return false;
+		}
 
-		std::copy(available.begin() + copyStart, available.end(), regions.begin());
+		unsigned long mask[mask_bits / bits_per_word] = {};
+		mask[node / bits_per_word] = 1ul << (node % bits_per_word);
 
-		return std::move(regions);
+		// The kernel reads maxnode - 1 bits
+		return syscall(SYS_mbind, ptr, size, bind_policy, mask, mask_bits + 1, 0) == 0;
+#else
+		return false;
+#endif
 	}
 
 	/**
-	 * @brief Release a reserved region
+	 * @brief Bind a new mapping to the NUMA node of its resource options
 	 *
-	 * @param target region to be released
+	 * Kernels without NUMA support place the pages themselves, any other failure unmaps the mapping
 	 *
-	 * @warning this does not check if region is acquired
+	 * @throws std::system_error if the pages cannot be bound, eg the node has no memory
 	 */
-	void release(region target)
+	inline void bind_mapping(uint8_t *ptr, std::size_t size, const resource_options &options)
 	{
-		available.push_back(target);
+#ifdef MEMORY_HAS_NUMA
+		if (options.numaNode < 0 || bind_to_node(ptr, size, options.numaNode))
+			return;
+
+		const int error = errno;
+		if (error == ENOSYS)
+			return;
+
+		munmap(ptr, size);
+		throw std::system_error(error, std::generic_category(), "Cannot bind memory to NUMA node " + std::to_string(options.numaNode));
+#else
+		(void)ptr;
+		(void)size;
+		(void)options;
+#endif
+	}
+
+	/*! @brief Write to every page, so they are faulted in now rather than on first use */
+	inline void prefault_pages(uint8_t *ptr, std::size_t size)
+	{
+		volatile uint8_t *pages = ptr;
+		for (std::size_t offset = 0; offset < size; offset += page_size)
+			pages[offset] = 0;
 	}
 
 	/**
-	 * @brief Bulk release regions
+	 * @brief Map anonymous memory aligned to alignment, trimming the over allocation
 	 *
-	 * @param regionRange A range of regions to be released
+	 * @return uint8_t* The start of the mapping or nullptr if the mapping failed
 	 */
-	void release(auto &regionRange)
+	inline uint8_t *map_aligned(std::size_t size, std::size_t alignment, int flags)
 	{
-		assert(regionRange.size() != 0 && "Region Range size cannot be zero");
-		ranges::append_range(available, regionRange);
+#ifdef MEMORY_HAS_MMAN
+		const std::size_t reserveSize = size + alignment;
+		void *mapping = mmap(nullptr, reserveSize, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | flags, -1, 0);
+		if (mapping == MAP_FAILED)
+			return nullptr;
+
+		uint8_t *reserveStart = static_cast<uint8_t *>(mapping);
+		uint8_t *start = reinterpret_cast<uint8_t *>(aligned_size(reinterpret_cast<std::size_t>(reserveStart), alignment));
+		uint8_t *end = start + size;
+
+		if (start != reserveStart)
+			munmap(reserveStart, start - reserveStart);
+		if (end != reserveStart + reserveSize)
+			munmap(end, reserveStart + reserveSize - end);
+
+		return start;
+#else
+		return nullptr;
+#endif
 	}
 
-  private:
 	/**
-	 * @brief internal helper function for bulk allocating regions
+	 * @brief Allocate the memory for a resource
 	 *
-	 * @param allocationAmount number of regions to allocate
+	 * @param size Size in bytes
+	 * @param options Resource options
+	 * @return uint8_t* Pointer to memory aligned to options.alignment
+	 *
+	 * @throws std::bad_alloc if the memory cannot be allocated
+	 * @throws std::system_error if the memory cannot be bound to options.numaNode
 	 */
-	void alloc_regions(uint32_t allocationAmount)
+	inline uint8_t *allocate_resource(std::size_t size, const resource_options &options)
 	{
-		uint32_t availableSize = available.size();
-		allocator.alloc_objects(resourceSize, allocationAmount, available);
-	}
+		assert((options.alignment & (options.alignment - 1)) == 0 && "Resource alignment must be a power of two");
 
-	uint32_t resourceSize;
-	uint32_t allocationAmount;
-	std::vector<region> available;
+#ifdef MEMORY_HAS_MMAN
+		if (is_mapped(options) && options.pages == page_mode::standard)
+		{
+			const std::size_t mapSize = mapped_size(size, options);
+			uint8_t *start = map_aligned(mapSize, std::max(options.alignment, page_size), 0);
+			if (!start)
+				throw std::bad_alloc();
 
-	resource_allocator allocator;
-};
+			bind_mapping(start, mapSize, options);
+			if (options.prefault)
+				prefault_pages(start, mapSize);
 
-// TODO implement memory::ranges::writer
-namespace ranges
-{
+			return start;
+		}
+
+		if (options.pages != page_mode::standard)
+		{
+			const std::size_t mapSize = mapped_size(size, options);
+			const std::size_t alignment = std::max(options.alignment, huge_page_size);
+			uint8_t *start = nullptr;
+
+#ifdef MAP_HUGETLB
+			// Huge tlb mappings are always huge page aligned, so only over allocate for larger alignments
+			if (options.pages == page_mode::explicit_huge)
+				start = alignment == huge_page_size
+							? static_cast<uint8_t *>(mmap(nullptr, mapSize, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0))
+							: map_aligned(mapSize, alignment, MAP_HUGETLB);
+
+			if (start == MAP_FAILED)
+				start = nullptr;
+#endif
+
+			if (!start)
+			{
+				start = map_aligned(mapSize, alignment, 0);
+				if (!start)
+					throw std::bad_alloc();
+#ifdef MADV_HUGEPAGE
+				madvise(start, mapSize, MADV_HUGEPAGE);
+#endif
+			}
+
+			bind_mapping(start, mapSize, options);
+			if (options.prefault)
+				prefault_pages(start, mapSize);
+
+			return start;
+		}
+#endif
+
+		uint8_t *ptr = static_cast<uint8_t *>(::operator new(size, std::align_val_t(options.alignment)));
+		if (options.prefault)
+			prefault_pages(ptr, size);
+		return ptr;
+	}
+
+	/**
+	 * @brief Release memory allocated by allocate_resource
+	 *
+	 * @param ptr Pointer returned by allocate_resource
+	 * @param size Size passed to allocate_resource
+	 * @param options Options passed to allocate_resource
+	 */
+	inline void deallocate_resource(uint8_t *ptr, std::size_t size, const resource_options &options)
+	{
+#ifdef MEMORY_HAS_MMAN
+		if (is_mapped(options))
+		{
+			munmap(ptr, mapped_size(size, options));
+			return;
+		}
+#endif
+
+		::operator delete(ptr, std::align_val_t(options.alignment));
+	}
+} // namespace detail
+
+/**
+ * @brief A backing store allocates the memory of resources
+ *
+ * Any type with static allocate and deallocate functions matching heap_backing can be used,
+ * this is the extension point for device visible memory such as Vulkan host visible allocations
+ */
+template <typename BackingT>
+concept backing_store = requires(uint8_t *ptr, std::size_t size, const resource_options &options) {
+	{ BackingT::allocate(size, options) } -> std::same_as<uint8_t *>;
+	BackingT::deallocate(ptr, size, options);
+};
+
+/**
+ * @brief Pageable memory from the heap or anonymous mappings, as selected by resource_options
+ *
+ */
+struct heap_backing
+{
+	/**
+	 * @brief Allocate memory
+	 *
+	 * @param size Size in bytes
+	 * @param options Alignment and page backing
+	 * @return uint8_t* Pointer to the allocated memory
+	 *
+	 * @throws std::bad_alloc if the memory cannot be allocated
+	 * @throws std::system_error if the memory cannot be bound to options.numaNode
+	 */
+	static uint8_t *allocate(std::size_t size, const resource_options &options)
+	{
+		return detail::allocate_resource(size, options);
+	}
+
+	/**
+	 * @brief Release memory returned by allocate
+	 *
+	 * @param ptr Pointer returned by allocate
+	 * @param size Size passed to allocate
+	 * @param options Options passed to allocate
+	 */
+	static void deallocate(uint8_t *ptr, std::size_t size, const resource_options &options)
+	{
+		detail::deallocate_resource(ptr, size, options);
+	}
+};
+
+/**
+ * @brief Function hooks for allocating page locked host memory through a graphics api
+ *
+ * eg cudaHostAlloc/cudaFreeHost, or a persistently mapped Vulkan host visible allocation
+ */
+struct host_memory_hooks
+{
+	/*! @brief Allocate page locked memory, return nullptr on failure */
+	uint8_t *(*allocate)(std::size_t size, const resource_options &options) = nullptr;
+	/*! @brief Release memory returned by allocate */
+	void (*deallocate)(uint8_t *ptr, std::size_t size, const resource_options &options) = nullptr;
+};
+
+/**
+ * @brief Page locked memory, so it can be the source or destination of a DMA transfer without a bounce buffer
+ *
+ * By default memory is page aligned and locked with mlock, installing hooks replaces this with the hooked api
+ *
+ * @warning hooks must be installed before the first pinned allocation and not changed afterwards
+ */
+struct pinned_backing
+{
+	/*! @brief Optional graphics api hooks, both or neither must be set */
+	static inline host_memory_hooks hooks;
+
+	/**
+	 * @brief Allocate page locked memory
+	 *
+	 * @param size Size in bytes
+	 * @param options Alignment and page backing, alignment is raised to at least page_size
+	 * @return uint8_t* Pointer to the allocated memory
+	 *
+	 * @throws std::bad_alloc if the memory cannot be allocated or locked
+	 */
+	static uint8_t *allocate(std::size_t size, const resource_options &options)
+	{
+		if (hooks.allocate)
+		{
+			uint8_t *ptr = hooks.allocate(size, options);
+			if (!ptr)
+				throw std::bad_alloc();
+			return ptr;
+		}
+
+		// Lock whole pages so no two allocations share a locked page
+		const resource_options pageOptions = page_options(options);
+		uint8_t *ptr = detail::allocate_resource(aligned_size(size, page_size), pageOptions);
+
+#ifdef MEMORY_HAS_MMAN
+		if (mlock(ptr, aligned_size(size, page_size)) != 0)
+		{
+			detail::deallocate_resource(ptr, aligned_size(size, page_size), pageOptions);
+			throw std::bad_alloc();
+		}
+#endif
+
+		return ptr;
+	}
+
+	/**
+	 * @brief Release memory returned by allocate
+	 *
+	 * @param ptr Pointer returned by allocate
+	 * @param size Size passed to allocate
+	 * @param options Options passed to allocate
+	 */
+	static void deallocate(uint8_t *ptr, std::size_t size, const resource_options &options)
+	{
+		if (hooks.deallocate)
+		{
+			hooks.deallocate(ptr, size, options);
+			return;
+		}
+
+#ifdef MEMORY_HAS_MMAN
+		munlock(ptr, aligned_size(size, page_size));
+#endif
+		detail::deallocate_resource(ptr, aligned_size(size, page_size), page_options(options));
+	}
+
+  private:
+	static resource_options page_options(resource_options options)
+	{
+		options.alignment = std::max(options.alignment, page_size);
+		return options;
+	}
+};
+
+/**
+ * @brief A memory block
+ *
+ * @tparam BackingT Backing store the memory block is allocated from
+ */
+template <backing_store BackingT = heap_backing>
+struct basic_resource
+{
+	/*! @brief backing store type*/
+	using backing_type = BackingT;
+
+	/*! @brief unsigned integer type*/
+	using size_type = std::size_t;
+
+	/*! @brief Non-allocating default constructor*/
+	basic_resource()
+		: basic_resource(nullptr, 0, {})
+	{
+	}
+
+	/**
+	 * @brief Allocate a region of specified size
+	 *
+	 * @param size Size in bytes of the allocated region
+	 */
+	basic_resource(size_type size)
+		: basic_resource(size, resource_options{})
+	{
+	}
+
+	/**
+	 * @brief Allocate an aligned region of specified size
+	 *
+	 * @param size Size in bytes of the allocated region
+	 * @param options Alignment and page backing of the region
+	 */
+	basic_resource(size_type size, const resource_options &options)
+		: basic_resource(BackingT::allocate(size, options), size, options)
+	{
+		assert(size != 0);
+	}
+
+	/*! @brief Move constructor */
+	basic_resource(basic_resource &&other) noexcept
+		: basic_resource(other.ptr, other.size, other.options)
+	{
+		other.ptr = nullptr;
+		other.size = 0;
+	}
+
+	/*! @brief Deleted copy constructor, delete to avoid double free */
+	basic_resource(const basic_resource &other) = delete;
+
+	/*! @brief Copy assignment operator, delete to avoid double free*/
+	basic_resource &operator=(const basic_resource &other) = delete;
+
+	/*! @brief Move Assignment, deletes previous contents if necessary */
+	basic_resource &operator=(basic_resource &&other)
+	{
+		if (ptr)
+			BackingT::deallocate(ptr, size, options);
+
+		ptr = other.ptr;
+		size = other.size;
+		options = other.options;
+
+		other.ptr = nullptr;
+		other.size = 0;
+
+		return *this;
+	}
+
+	/*! @brief Get a handle for the region*/
+	inline operator region() const
+	{
+		return region(ptr, ptr + size);
+	}
+
+	/**
+	 * @brief Get a handle for an unsafe memory writer, avoid using this
+	 *
+	 * This should only really be used with fixed size ranges, like string_array
+	 * @warning This is a memory unsafe function and probably shouldn't be used
+	 */
+	inline operator unsafe::writer() const
+	{
+		return unsafe::writer(ptr);
+	}
+
+	/*! @brief Deconstructor*/
+	virtual ~basic_resource()
+	{
+		if (ptr)
+			BackingT::deallocate(ptr, size, options);
+	}
+
+	/**
+	 * @brief Get a pointer to the underlying memory block
+	 */
+	inline uint8_t *get_pointer() const
+	{
+		return ptr;
+	}
+
+	/**
+	 * @brief Get the options the memory block was allocated with
+	 */
+	inline const resource_options &get_options() const
+	{
+		return options;
+	}
+
+  private:
+	/*! @brief Internal Constructor to help with member assignment */
+	basic_resource(uint8_t *ptr, size_type size, const resource_options &options)
+		: ptr(ptr), size(size), options(options)
+	{
+	}
+
+	uint8_t *ptr;
+	size_type size;
+	resource_options options;
+};
+
+/*! @brief A heap allocated memory block */
+using resource = basic_resource<heap_backing>;
+
+/*! @brief A page locked memory block */
+using pinned_resource = basic_resource<pinned_backing>;
+
+/**
+ * @brief Slab allocator for fixed size resources
+ *
+ * Every call to alloc_objects makes a single slab allocation that is carved into equally aligned regions,
+ * slabs are owned by the allocator and released as a unit on deconstruction or with free_slab.
+ * Slabs are kept sorted by address, so the slab of a region is found with a binary search
+ *
+ * @tparam BackingT Backing store of the slabs
+ */
+template <backing_store BackingT = heap_backing>
+struct basic_resource_allocator
+{
+	using value_type = basic_resource<BackingT>;
+	using size_type = typename value_type::size_type;
+
+	/*! @brief Slab index of regions that weren't carved by this allocator */
+	static constexpr size_type npos = SIZE_MAX;
+
+	/**
+	 * @brief Constructor
+	 *
+	 * @param options Options for every slab, every region carved from a slab is aligned to options.alignment
+	 */
+	basic_resource_allocator(const resource_options &options = {})
+		: options(options)
+	{
+	}
+
+	/**
+	 * @brief Bulk allocate memory resources
+	 *
+	 * @param resourceSize Resource Size in bytes
+	 * @param amount Number of resource to allocate
+	 * @param dest Destination range for those resources
+	 */
+	void alloc_objects(size_type resourceSize, uint32_t amount, auto &&dest)
+	{
+		assert(resourceSize != 0 && "Resource size cannot be zero");
+		assert(amount != 0 && "Allocation amount cannot be zero");
+
+		const size_type stride = aligned_size(resourceSize, options.alignment);
+
+		value_type slab(stride * amount, options);
+		uint8_t *regionStart = slab.get_pointer();
+		counters.on_allocate(stride * amount);
+		slabs.insert(std::ranges::upper_bound(slabs, regionStart, {}, &value_type::get_pointer), std::move(slab));
+
+		const size_type oldDestSize = dest.size();
+		dest.resize(oldDestSize + amount);
+
+		for (auto it = dest.begin() + oldDestSize; it != dest.end(); ++it, regionStart += stride)
+			*it = region(regionStart, resourceSize);
+	}
+
+	/**
+	 * @brief Allocate a single slab, for callers that carve it themselves
+	 *
+	 * @param size Size of the slab in bytes
+	 * @return region The slab, owned by the allocator
+	 */
+	region alloc_slab(size_type size)
+	{
+		assert(size != 0 && "Slab size cannot be zero");
+
+		value_type slab(size, options);
+		const region output(slab.get_pointer(), size);
+		counters.on_allocate(size);
+		slabs.insert(std::ranges::upper_bound(slabs, output.startPtr, {}, &value_type::get_pointer), std::move(slab));
+		return output;
+	}
+
+	/**
+	 * @brief Check if a region was carved from one of this allocator's slabs
+	 *
+	 * @param target Region to look up
+	 * @return true if target starts inside a slab owned by this allocator
+	 */
+	bool owns(const region &target) const
+	{
+		return find_slab(target) != npos;
+	}
+
+	/**
+	 * @brief Find the slab a region was carved from
+	 *
+	 * @param target Region to look up
+	 * @return size_type Index of the slab containing the start of target, or npos
+	 */
+	size_type find_slab(const region &target) const
+	{
+		auto it = std::ranges::upper_bound(slabs, target.startPtr, {}, &value_type::get_pointer);
+		if (it == slabs.begin())
+			return npos;
+
+		--it;
+		const region slabRegion = *it;
+		return target.startPtr < slabRegion.endPtr ? size_type(it - slabs.begin()) : npos;
+	}
+
+	/**
+	 * @brief Get the number of regions a slab was carved into
+	 *
+	 * @param index Index of the slab
+	 * @param resourceSize Resource size the slab was allocated with
+	 */
+	size_type slab_region_count(size_type index, size_type resourceSize) const
+	{
+		const region slabRegion = slabs[index];
+		return slabRegion.size() / aligned_size(resourceSize, options.alignment);
+	}
+
+	/**
+	 * @brief Return a slab to its backing store
+	 *
+	 * @param index Index of the slab, indices of later slabs shift down by one
+	 * @return size_type Size of the freed slab in bytes
+	 *
+	 * @warning every region carved from the slab becomes invalid
+	 */
+	size_type free_slab(size_type index)
+	{
+		const region slabRegion = slabs[index];
+		slabs.erase(slabs.begin() + index);
+		counters.on_free(slabRegion.size());
+		return slabRegion.size();
+	}
+
+	/*! @brief Get a snapshot of the allocator's counters, all zero unless MEMORY_ENABLE_STATISTICS is set */
+	allocator_statistics get_statistics() const
+	{
+		return counters.snapshot();
+	}
+
+	/*! @brief Get the number of slabs owned by this allocator */
+	size_type slab_count() const
+	{
+		return slabs.size();
+	}
+
+	/*! @brief Get the slabs owned by this allocator, eg to register them with a device or the kernel */
+	std::span<const value_type> get_slabs() const
+	{
+		return slabs;
+	}
+
+	/*! @brief Get the options every slab is allocated with, every carved region starts aligned to options.alignment */
+	const resource_options &get_options() const
+	{
+		return options;
+	}
+
+  private:
+	resource_options options;
+	std::vector<value_type> slabs;
+	[[no_unique_address]] detail::allocator_counters counters;
+};
+
+/*! @brief Slab allocator for heap allocated resources */
+using resource_allocator = basic_resource_allocator<heap_backing>;
+
+#ifndef MEMORY_POOL_REGISTRY_SIZE
+/*! @brief Maximum number of pools that can be alive at once */
+#define MEMORY_POOL_REGISTRY_SIZE 4096
+#endif
+
+namespace detail
+{
+	/*! @brief A type erased pool */
+	struct pool_registry_entry
+	{
+		void *pool = nullptr;
+		void (*release)(void *pool, region target) = nullptr;
+		void (*releaseRange)(void *pool, std::span<region> targets) = nullptr;
+	};
+
+	/**
+	 * @brief Registry of live pools, lets handles refer to their pool with a 32 bit index
+	 *
+	 * Entries are stable while their pool is alive, so lookups don't lock
+	 */
+	struct pool_registry
+	{
+		using entry = pool_registry_entry;
+		using release_function = decltype(entry::release);
+		using release_range_function = decltype(entry::releaseRange);
+
+		/*! @brief Index of no pool */
+		static constexpr uint32_t invalid_index = UINT32_MAX;
+
+		/**
+		 * @brief Register a pool
+		 *
+		 * @return uint32_t index of the pool
+		 *
+		 * @throws std::length_error if MEMORY_POOL_REGISTRY_SIZE pools are already registered
+		 */
+		static uint32_t add(void *pool, release_function release, release_range_function releaseRange)
+		{
+			std::lock_guard lock(mutex);
+
+			uint32_t index;
+			if (!freeIndices.empty())
+			{
+				index = freeIndices.back();
+				freeIndices.pop_back();
+			}
+			else if (used < MEMORY_POOL_REGISTRY_SIZE)
+				index = used++;
+			else
+				throw std::length_error("Too many live memory pools, increase MEMORY_POOL_REGISTRY_SIZE");
+
+			entries[index] = entry{pool, release, releaseRange};
+			return index;
+		}
+
+		/*! @brief Unregister a pool, after this its index may be reused */
+		static void remove(uint32_t index)
+		{
+			std::lock_guard lock(mutex);
+			entries[index] = entry{};
+			freeIndices.push_back(index);
+		}
+
+		/*! @brief Get the entry of a registered pool */
+		static const entry &get(uint32_t index)
+		{
+			assert(index < MEMORY_POOL_REGISTRY_SIZE && entries[index].pool && "Pool is not registered");
+			return entries[index];
+		}
+
+	  private:
+		static inline entry entries[MEMORY_POOL_REGISTRY_SIZE];
+		static inline std::mutex mutex;
+		static inline std::vector<uint32_t> freeIndices;
+		static inline uint32_t used = 0;
+	};
+
+	/**
+	 * @brief Registers a pool for as long as it is alive
+	 *
+	 * Held as a member, so the entry is also removed when a later member or the pool's constructor body throws
+	 */
+	struct pool_registration
+	{
+		pool_registration(void *pool, pool_registry::release_function release, pool_registry::release_range_function releaseRange)
+			: registryIndex(pool_registry::add(pool, release, releaseRange))
+		{
+		}
+
+		pool_registration(const pool_registration &) = delete;
+		pool_registration &operator=(const pool_registration &) = delete;
+
+		~pool_registration()
+		{
+			pool_registry::remove(registryIndex);
+		}
+
+		/*! @brief Get the index of the pool in the registry */
+		uint32_t index() const
+		{
+			return registryIndex;
+		}
+
+	  private:
+		uint32_t registryIndex;
+	};
+} // namespace detail
+
+/**
+ * @brief A move only handle for a pooled region, the region is released to its pool on destruction
+ *
+ * @warning The pool must outlive the handle
+ */
+struct pooled_region
+{
+	/*! @brief Empty handle */
+	pooled_region() = default;
+
+	/**
+	 * @brief Take ownership of an acquired region
+	 *
+	 * @param target Region acquired from the pool
+	 * @param poolIndex Registry index of the pool
+	 */
+	pooled_region(region target, uint32_t poolIndex)
+		: target(target), poolIndex(poolIndex)
+	{
+	}
+
+	pooled_region(pooled_region &&other) noexcept
+		: target(std::move(other.target)), poolIndex(other.poolIndex)
+	{
+		other.poolIndex = detail::pool_registry::invalid_index;
+	}
+
+	pooled_region(const pooled_region &) = delete;
+	pooled_region &operator=(const pooled_region &) = delete;
+
+	/*! @brief Move Assignment, releases the previous region if necessary */
+	pooled_region &operator=(pooled_region &&other) noexcept
+	{
+		release();
+
+		target = std::move(other.target);
+		poolIndex = other.poolIndex;
+		other.poolIndex = detail::pool_registry::invalid_index;
+
+		return *this;
+	}
+
+	/*! @brief Deconstructor, releases the region */
+	~pooled_region()
+	{
+		release();
+	}
+
+	/*! @brief Release the region to its pool early */
+	void release()
+	{
+		if (poolIndex == detail::pool_registry::invalid_index)
+			return;
+
+		const detail::pool_registry::entry &pool = detail::pool_registry::get(poolIndex);
+		pool.release(pool.pool, target);
+
+		target = region();
+		poolIndex = detail::pool_registry::invalid_index;
+	}
+
+	/*! @brief Give up ownership without releasing, the caller must release the region to the pool */
+	region detach()
+	{
+		poolIndex = detail::pool_registry::invalid_index;
+		return std::move(target);
+	}
+
+	/*! @brief Get the region */
+	const region &get() const
+	{
+		return target;
+	}
+
+	/*! @brief Get a handle for the region */
+	operator region() const
+	{
+		return target;
+	}
+
+	/*! @brief Check if the handle owns a region */
+	explicit operator bool() const
+	{
+		return poolIndex != detail::pool_registry::invalid_index;
+	}
+
+  private:
+	region target;
+	uint32_t poolIndex = detail::pool_registry::invalid_index;
+};
+
+/**
+ * @brief A move only handle for bulk acquired regions, the regions are released to their pool on destruction
+ *
+ * @warning The pool must outlive the handle
+ */
+struct pooled_regions
+{
+	/*! @brief Empty handle */
+	pooled_regions() = default;
+
+	/**
+	 * @brief Take ownership of acquired regions
+	 *
+	 * @param targets Regions acquired from the pool
+	 * @param poolIndex Registry index of the pool
+	 */
+	pooled_regions(std::vector<region> &&targets, uint32_t poolIndex)
+		: targets(std::move(targets)), poolIndex(poolIndex)
+	{
+	}
+
+	pooled_regions(pooled_regions &&other) noexcept
+		: targets(std::move(other.targets)), poolIndex(other.poolIndex)
+	{
+		other.poolIndex = detail::pool_registry::invalid_index;
+	}
+
+	pooled_regions(const pooled_regions &) = delete;
+	pooled_regions &operator=(const pooled_regions &) = delete;
+
+	/*! @brief Move Assignment, releases the previous regions if necessary */
+	pooled_regions &operator=(pooled_regions &&other) noexcept
+	{
+		release();
+
+		targets = std::move(other.targets);
+		poolIndex = other.poolIndex;
+		other.poolIndex = detail::pool_registry::invalid_index;
+
+		return *this;
+	}
+
+	/*! @brief Deconstructor, releases the regions */
+	~pooled_regions()
+	{
+		release();
+	}
+
+	/*! @brief Release the regions to their pool early */
+	void release()
+	{
+		if (poolIndex == detail::pool_registry::invalid_index)
+			return;
+
+		if (!targets.empty())
+		{
+			const detail::pool_registry::entry &pool = detail::pool_registry::get(poolIndex);
+			pool.releaseRange(pool.pool, targets);
+		}
+
+		targets.clear();
+		poolIndex = detail::pool_registry::invalid_index;
+	}
+
+	/*! @brief Give up ownership without releasing, the caller must release the regions to the pool */
+	std::vector<region> detach()
+	{
+		poolIndex = detail::pool_registry::invalid_index;
+		return std::move(targets);
+	}
+
+	/*! @brief Get the regions */
+	std::span<const region> get() const
+	{
+		return targets;
+	}
+
+	/*! @brief Get the number of regions */
+	std::size_t size() const
+	{
+		return targets.size();
+	}
+
+	/*! @brief Get a region */
+	const region &operator[](std::size_t index) const
+	{
+		return targets[index];
+	}
+
+	auto begin() const
+	{
+		return targets.begin();
+	}
+
+	auto end() const
+	{
+		return targets.end();
+	}
+
+  private:
+	std::vector<region> targets;
+	uint32_t poolIndex = detail::pool_registry::invalid_index;
+};
+
+namespace detail
+{
+	/*! @brief Byte written over released regions in debug pools, so reads after release stand out */
+	constexpr uint8_t debug_poison_byte = 0xDD;
+
+	/*! @brief Mark memory as off limits to AddressSanitizer, a no-op without it */
+	inline void asan_poison(const region &target)
+	{
+#ifdef MEMORY_HAS_ASAN
+		ASAN_POISON_MEMORY_REGION(target.startPtr, target.size());
+#else
+		(void)target;
+#endif
+	}
+
+	/*! @brief Mark memory as usable to AddressSanitizer, a no-op without it */
+	inline void asan_unpoison(const region &target)
+	{
+#ifdef MEMORY_HAS_ASAN
+		ASAN_UNPOISON_MEMORY_REGION(target.startPtr, target.size());
+#else
+		(void)target;
+#endif
+	}
+
+#if MEMORY_DEBUG_POOLS
+	/**
+	 * @brief Tracks which regions of a fixed size pool are acquired, with a bitmap per slab
+	 *
+	 * Idle regions are filled with debug_poison_byte and poisoned for AddressSanitizer
+	 */
+	struct pool_debug_tracker
+	{
+		/*! @brief Deconstructor, unpoisons every slab before the allocator frees it */
+		~pool_debug_tracker()
+		{
+			for (const slab_entry &slab : slabs)
+				asan_unpoison(slab.memory);
+		}
+
+		/**
+		 * @brief Start tracking a new slab, its regions are idle
+		 *
+		 * @param memory The slab
+		 * @param stride Distance between the starts of its regions
+		 * @param regionSize Size of each region
+		 */
+		void on_growth(const region &memory, std::size_t stride, std::size_t regionSize)
+		{
+			const std::size_t regionCount = memory.size() / stride;
+
+			auto position = std::ranges::upper_bound(slabs, memory.startPtr, {}, [](const slab_entry &slab) { return slab.memory.startPtr; });
+			slab_entry &slab = *slabs.insert(position, slab_entry{memory, stride, std::vector<uint64_t>((regionCount + 63) / 64, 0)});
+
+			for (std::size_t i = 0; i < regionCount; ++i)
+				poison(region(slab.memory.startPtr + i * stride, regionSize));
+		}
+
+		/*! @brief Mark a region acquired, it must be idle */
+		void on_acquire(const region &target)
+		{
+			auto [slab, index] = locate(target);
+			assert(slab && "Acquired region was not allocated by this pool");
+
+			uint64_t &word = slab->acquired[index / 64];
+			const uint64_t bit = uint64_t(1) << (index % 64);
+			assert(!(word & bit) && "Region was acquired twice, the pool's free list is corrupt");
+			word |= bit;
+
+			asan_unpoison(target);
+		}
+
+		/*! @brief Mark a region idle, it must be acquired from this pool */
+		void on_release(const region &target)
+		{
+			auto [slab, index] = locate(target);
+			assert(slab && "Released region was not acquired from this pool");
+
+			uint64_t &word = slab->acquired[index / 64];
+			const uint64_t bit = uint64_t(1) << (index % 64);
+			assert((word & bit) && "Region was released twice");
+			word &= ~bit;
+
+			poison(target);
+		}
+
+		/*! @brief Stop tracking a slab before it is freed, all of its regions must be idle */
+		void on_free(const region &memory)
+		{
+			auto it = std::ranges::find(slabs, memory.startPtr, [](const slab_entry &slab) { return slab.memory.startPtr; });
+			assert(it != slabs.end() && "Freed slab is not tracked");
+			assert(std::ranges::all_of(it->acquired, [](uint64_t word) { return word == 0; }) && "Freed slab has acquired regions");
+
+			asan_unpoison(it->memory);
+			slabs.erase(it);
+		}
+
+	  private:
+		struct slab_entry
+		{
+			region memory;
+			std::size_t stride;
+			std::vector<uint64_t> acquired;
+		};
+
+		/*! @brief Find the slab and region index of a region, slab is nullptr if it isn't a region of any slab */
+		std::pair<slab_entry *, std::size_t> locate(const region &target)
+		{
+			auto it = std::ranges::upper_bound(slabs, target.startPtr, {}, [](const slab_entry &slab) { return slab.memory.startPtr; });
+			if (it == slabs.begin())
+				return {nullptr, 0};
+
+			--it;
+			const std::size_t offset = target.startPtr - it->memory.startPtr;
+			if (target.startPtr >= it->memory.endPtr || offset % it->stride != 0)
+				return {nullptr, 0};
+
+			return {&*it, offset / it->stride};
+		}
+
+		static void poison(const region &target)
+		{
+			memset(target.startPtr, debug_poison_byte, target.size());
+			asan_poison(target);
+		}
+
+		std::vector<slab_entry> slabs;
+	};
+#else
+	// Untracked pools, with [[no_unique_address]] the tracker takes no space and every call compiles away
+
+	struct pool_debug_tracker
+	{
+		void on_growth(const region &, std::size_t, std::size_t) {}
+		void on_acquire(const region &) {}
+		void on_release(const region &) {}
+		void on_free(const region &) {}
+	};
+#endif
+} // namespace detail
+
+/**
+ * @brief When a pool returns idle slabs to the backing store
+ *
+ */
+struct trim_policy
+{
+	/*! @brief Number of epochs demand must stay low before idle slabs are freed, zero disables automatic trimming */
+	uint32_t idleEpochs = 0;
+	/*! @brief Headroom kept above the peak number of regions in use over the last idleEpochs epochs */
+	float keepFactor = 1.5f;
+};
+
+/**
+ * @brief A pool of memory allocations
+ *
+ * It's primary purpose it to allow for quick access to cache memory to then copy to and from gpu
+ *
+ * The pool grows on demand and only shrinks when trimmed, either explicitly with trim or automatically
+ * by advance_epoch following a trim_policy. A slab is only freed once every region carved from it is idle
+ *
+ * @tparam BackingT Backing store of the pooled regions, use pinned_backing for regions that are DMA'd directly
+ *
+ * @warning Releases all allocated regions on deconstruction
+ */
+template <backing_store BackingT = heap_backing>
+struct basic_resource_pool
+{
+	/**
+	 * @brief Constructor
+	 * @param resourceSize The size of allocated regions, this should not be zero
+	 * @param allocationAmount Number of regions to allocate when empty, this should not be zero
+	 * @param options Alignment and page backing of every region
+	 *
+	 * @warning Neither size parameter should be zero
+	 */
+	basic_resource_pool(std::size_t resourceSize, uint32_t allocationAmount = 1, const resource_options &options = {})
+		: resourceSize(resourceSize),
+		  allocationAmount(allocationAmount),
+		  allocator(options),
+		  registration(this, &release_callback, &release_range_callback)
+	{
+		assert(resourceSize != 0 && "Resource size cannot be zero");
+		assert(allocationAmount != 0 && "Allocation amount cannot be zero");
+
+		alloc_regions(allocationAmount);
+	}
+
+	/*! @brief Deleted copy constructor, pooled handles refer to the pool by address */
+	basic_resource_pool(const basic_resource_pool &) = delete;
+
+	/*! @brief Deleted copy assignment, pooled handles refer to the pool by address */
+	basic_resource_pool &operator=(const basic_resource_pool &) = delete;
+
+	/*! @brief Acquire a region from the pool*/
+	region acquire()
+	{
+		if (available.empty())
+			alloc_regions(allocationAmount);
+
+		region output = available.back();
+		available.pop_back();
+		track_acquire(1);
+		counters.on_acquire(1, resourceSize);
+		tracker.on_acquire(output);
+		return output;
+	}
+
+	/**
+	 * @brief Bulk acquire regions into caller supplied storage, this does not allocate unless the pool grows
+	 *
+	 * If the pool is short the deficit is allocated, rounded up to a multiple of allocationAmount
+	 *
+	 * @param dest Destination for the acquired regions, one region is acquired per element
+	 */
+	void acquire(std::span<region> dest)
+	{
+		assert(!dest.empty() && "Cannot bulk acquire zero regions");
+
+		if (available.size() < dest.size())
+		{
+			const std::size_t deficit = dest.size() - available.size();
+			alloc_regions(((deficit + allocationAmount - 1) / allocationAmount) * allocationAmount);
+		}
+
+		const std::size_t copyStart = available.size() - dest.size();
+
+		std::copy(available.begin() + copyStart, available.end(), dest.begin());
+		available.resize(copyStart);
+		for (const region &target : dest)
+			tracker.on_acquire(target);
+		track_acquire(dest.size());
+		counters.on_bulk_acquire(dest.size(), resourceSize);
+	}
+
+	/**
+	 * @brief Bulk acquire a number of regions
+	 *
+	 * @param count Number of regions needed
+	 * @return std::vector<region> acquired regions
+	 */
+	std::vector<region> acquire(uint32_t count)
+	{
+		std::vector<region> regions(count);
+		acquire(std::span<region>(regions));
+		return regions;
+	}
+
+	/*! @brief Acquire a region that is released back to the pool when the handle is destroyed */
+	pooled_region acquire_pooled()
+	{
+		return pooled_region(acquire(), registration.index());
+	}
+
+	/**
+	 * @brief Bulk acquire regions that are released back to the pool when the handle is destroyed
+	 *
+	 * @param count Number of regions needed
+	 */
+	pooled_regions acquire_pooled(uint32_t count)
+	{
+		return pooled_regions(acquire(count), registration.index());
+	}
+
+	/**
+	 * @brief Release a reserved region
+	 *
+	 * @param target region to be released
+	 *
+	 * @warning this only checks if region is acquired when MEMORY_DEBUG_POOLS is set
+	 */
+	void release(region target)
+	{
+		tracker.on_release(target);
+		available.push_back(target);
+		--inUse;
+		counters.on_release(1, resourceSize);
+	}
+
+	/**
+	 * @brief Bulk release regions
+	 *
+	 * @param regionRange A range of regions to be released
+	 */
+	void release(auto &regionRange)
+	{
+		assert(regionRange.size() != 0 && "Region Range size cannot be zero");
+		for (const region &target : regionRange)
+			tracker.on_release(target);
+		::ranges::append_range(available, regionRange);
+		inUse -= regionRange.size();
+		counters.on_release(regionRange.size(), resourceSize);
+	}
+
+	/*! @brief Get the allocator owning the pooled regions */
+	const basic_resource_allocator<BackingT> &get_allocator() const
+	{
+		return allocator;
+	}
+
+	/*! @brief Get the options of the pooled regions, every region starts aligned to options.alignment */
+	const resource_options &get_options() const
+	{
+		return allocator.get_options();
+	}
+
+	/*! @brief Get a snapshot of the pool's counters, all zero unless MEMORY_ENABLE_STATISTICS is set */
+	pool_statistics get_statistics() const
+	{
+		return counters.snapshot();
+	}
+
+	/*! @brief Get the number of regions currently acquired */
+	std::size_t in_use() const
+	{
+		return inUse;
+	}
+
+	/*! @brief Get the number of idle regions held by the pool */
+	std::size_t idle() const
+	{
+		return available.size();
+	}
+
+	/*! @brief Get the peak number of regions acquired at once over the lifetime of the pool */
+	std::size_t high_water_mark() const
+	{
+		return highWater;
+	}
+
+	/**
+	 * @brief Return fully idle slabs to the backing store
+	 *
+	 * Slabs are freed in address order while at least keepIdle idle regions remain
+	 *
+	 * @param keepIdle Number of idle regions to keep for future acquires
+	 * @return std::size_t Number of bytes returned to the backing store
+	 */
+	std::size_t trim(std::size_t keepIdle = 0)
+	{
+		if (available.size() <= keepIdle)
+			return 0;
+
+		// Count the idle regions of every slab
+		std::vector<std::size_t> owners(available.size());
+		std::vector<std::size_t> idleCounts(allocator.slab_count(), 0);
+		for (std::size_t i = 0; i < available.size(); ++i)
+		{
+			owners[i] = allocator.find_slab(available[i]);
+			assert(owners[i] != allocator.npos && "Pool holds a region it didn't allocate");
+			++idleCounts[owners[i]];
+		}
+
+		std::vector<bool> freed(idleCounts.size(), false);
+		std::size_t remaining = available.size();
+		for (std::size_t slab = 0; slab < idleCounts.size(); ++slab)
+		{
+			const std::size_t regionCount = allocator.slab_region_count(slab, resourceSize);
+			if (idleCounts[slab] == regionCount && remaining - regionCount >= keepIdle)
+			{
+				freed[slab] = true;
+				remaining -= regionCount;
+			}
+		}
+
+		if (remaining == available.size())
+			return 0;
+
+		counters.on_trim(available.size() - remaining, resourceSize);
+
+		std::size_t kept = 0;
+		for (std::size_t i = 0; i < available.size(); ++i)
+			if (!freed[owners[i]])
+				available[kept++] = available[i];
+		available.resize(kept);
+
+		// Free from the back so the remaining slab indices stay valid
+		std::size_t freedBytes = 0;
+		for (std::size_t slab = freed.size(); slab-- > 0;)
+			if (freed[slab])
+			{
+				tracker.on_free(allocator.get_slabs()[slab]);
+				freedBytes += allocator.free_slab(slab);
+			}
+
+		return freedBytes;
+	}
+
+	/**
+	 * @brief Set the automatic trimming policy, this restarts the epoch window
+	 *
+	 * @param policy Trimming policy applied by advance_epoch
+	 */
+	void set_trim_policy(const trim_policy &policy)
+	{
+		trimPolicy = policy;
+		epochPeaks.assign(policy.idleEpochs, 0);
+		epochCursor = 0;
+		epochCount = 0;
+		epochPeak = inUse;
+	}
+
+	/*! @brief Get the automatic trimming policy */
+	const trim_policy &get_trim_policy() const
+	{
+		return trimPolicy;
+	}
+
+	/**
+	 * @brief End an epoch, eg a frame, applying the trimming policy
+	 *
+	 * Once a full window of idleEpochs epochs has passed, idle slabs are freed down to
+	 * the window's peak in use count times keepFactor
+	 *
+	 * @return std::size_t Number of bytes returned to the backing store
+	 */
+	std::size_t advance_epoch()
+	{
+		if (trimPolicy.idleEpochs == 0)
+			return 0;
+
+		epochPeaks[epochCursor] = epochPeak;
+		epochCursor = (epochCursor + 1) % trimPolicy.idleEpochs;
+		epochPeak = inUse;
+
+		if (epochCount < trimPolicy.idleEpochs)
+			++epochCount;
+		if (epochCount < trimPolicy.idleEpochs)
+			return 0;
+
+		const std::size_t windowPeak = *std::ranges::max_element(epochPeaks);
+		const std::size_t keep = std::size_t(windowPeak * trimPolicy.keepFactor + 0.5f);
+		return trim(keep > inUse ? keep - inUse : 0);
+	}
+
+  private:
+	/*! @brief Update the in use and peak counts after acquiring */
+	void track_acquire(std::size_t count)
+	{
+		inUse += count;
+		highWater = std::max(highWater, inUse);
+		epochPeak = std::max(epochPeak, inUse);
+	}
+
+	/**
+	 * @brief internal helper function for bulk allocating regions
+	 *
+	 * @param allocationAmount number of regions to allocate
+	 */
+	void alloc_regions(uint32_t allocationAmount)
+	{
+		allocator.alloc_objects(resourceSize, allocationAmount, available);
+		counters.on_growth(allocationAmount, resourceSize);
+
+		if constexpr (MEMORY_DEBUG_POOLS)
+		{
+			const basic_resource<BackingT> &slab = allocator.get_slabs()[allocator.find_slab(available.back())];
+			tracker.on_growth(slab, aligned_size(resourceSize, slab.get_options().alignment), resourceSize);
+		}
+	}
+
+	static void release_callback(void *pool, region target)
+	{
+		static_cast<basic_resource_pool *>(pool)->release(target);
+	}
+
+	static void release_range_callback(void *pool, std::span<region> targets)
+	{
+		static_cast<basic_resource_pool *>(pool)->release(targets);
+	}
+
+	std::size_t resourceSize;
+	uint32_t allocationAmount;
+	std::vector<region> available;
+
+	std::size_t inUse = 0;
+	std::size_t highWater = 0;
+
+	trim_policy trimPolicy;
+	std::vector<std::size_t> epochPeaks;
+	uint32_t epochCursor = 0;
+	uint32_t epochCount = 0;
+	std::size_t epochPeak = 0;
+
+	basic_resource_allocator<BackingT> allocator;
+	detail::pool_registration registration;
+	[[no_unique_address]] detail::pool_counters counters;
+	// Declared after the allocator, so slabs are unpoisoned before they are freed
+	[[no_unique_address]] detail::pool_debug_tracker tracker;
+};
+
+/*! @brief A pool of heap allocated regions */
+using resource_pool = basic_resource_pool<heap_backing>;
+
+/*! @brief A pool of page locked regions, for direct transfers to and from the gpu */
+using pinned_resource_pool = basic_resource_pool<pinned_backing>;
+
+namespace ranges
+{
+	/**
+	 * @brief A streaming writer over a chain of pooled regions
+	 *
+	 * When the current region is full the next one is acquired from the pool and writing continues there,
+	 * so writes never fail. The written data is available as a scatter list of filled regions.
+	 *
+	 * @tparam PoolT Pool the regions are acquired from
+	 *
+	 * @warning Releases all acquired regions on deconstruction
+	 */
+	template <typename PoolT = resource_pool>
 	struct writer
 	{
-		resource_pool &resourcePool;
+		using size_type = std::size_t;
+
+		/**
+		 * @brief Constructor, does not acquire any region until the first write
+		 *
+		 * @param resourcePool Pool to acquire regions from, must outlive the writer
+		 */
+		writer(PoolT &resourcePool)
+			: resourcePool(&resourcePool)
+		{
+		}
+
+		writer(const writer &) = delete;
+		writer &operator=(const writer &) = delete;
+
+		/*! @brief Move constructor, takes the regions of other and leaves it empty */
+		writer(writer &&other) noexcept
+			: resourcePool(other.resourcePool), chain(std::move(other.chain)), completedBytes(other.completedBytes), head(other.head)
+		{
+			other.chain.clear();
+			other.completedBytes = 0;
+			other.head = memory::writer();
+		}
+
+		/*! @brief Move assignment, releases the current regions then takes the regions of other and leaves it empty */
+		writer &operator=(writer &&other) noexcept
+		{
+			if (this != &other)
+			{
+				release();
+				resourcePool = other.resourcePool;
+				chain = std::move(other.chain);
+				completedBytes = other.completedBytes;
+				head = other.head;
+
+				other.chain.clear();
+				other.completedBytes = 0;
+				other.head = memory::writer();
+			}
+			return *this;
+		}
+
+		/*! @brief Deconstructor, releases all acquired regions */
+		~writer()
+		{
+			release();
+		}
+
+		/**
+		 * @brief Write data, splitting it across regions if needed
+		 *
+		 * @param src Pointer to start of data
+		 * @param amount Number of bytes to write
+		 */
+		void write(const void *src, size_type amount)
+		{
+			const uint8_t *bytes = static_cast<const uint8_t *>(src);
+
+			while (amount != 0)
+			{
+				const size_type chunk = std::min(amount, head.bytes_remaining());
+				if (chunk == 0)
+				{
+					advance();
+					continue;
+				}
+
+				head.write(bytes, chunk);
+				bytes += chunk;
+				amount -= chunk;
+			}
+		}
+
+		/**
+		 * @brief Write data, splitting it across regions if needed, large writes use non temporal stores
+		 *
+		 * Streaming is decided from the whole write, so a large write is streamed even when the regions are smaller than streaming_threshold
+		 *
+		 * @param src Pointer to start of data
+		 * @param amount Number of bytes to write, non temporal stores are used from streaming_threshold
+		 */
+		void write_streaming(const void *src, size_type amount)
+		{
+			if (amount < streaming_threshold)
+			{
+				write(src, amount);
+				return;
+			}
+
+			const uint8_t *bytes = static_cast<const uint8_t *>(src);
+
+			while (amount != 0)
+			{
+				const size_type chunk = std::min(amount, head.bytes_remaining());
+				if (chunk == 0)
+				{
+					advance();
+					continue;
+				}
+
+				stream_copy(head.reserve(chunk).get_pointer(), bytes, chunk);
+				bytes += chunk;
+				amount -= chunk;
+			}
+		}
+
+		/**
+		 * @brief Write an object, splitting it across regions if needed
+		 *
+		 * @tparam ObjectT Object type
+		 * @param object Object to write
+		 */
+		template <typename ObjectT>
+		void write(const ObjectT &object)
+		{
+			static_assert(std::is_trivially_copyable_v<ObjectT>, "Only trivially copyable objects can be written");
+			write(&object, sizeof(ObjectT));
+		}
+
+		/**
+		 * @brief Write a contigious range, splitting it across regions if needed
+		 *
+		 * @tparam RangeT Range Type
+		 * @param range Range to write
+		 */
+		template <typename RangeT>
+		void write(const RangeT &range) requires std::ranges::contiguous_range<RangeT> && std::ranges::sized_range<RangeT>
+		{
+			static_assert(std::is_trivially_copyable_v<std::ranges::range_value_t<RangeT>>, "Only ranges of trivially copyable objects can be written");
+			write(std::ranges::data(range), std::ranges::size(range) * sizeof(std::ranges::range_value_t<RangeT>));
+		}
+
+		/**
+		 * @brief Write data without splitting it, moving to a new region if it doesn't fit in the current one
+		 *
+		 * @param src Pointer to start of data
+		 * @param amount Number of bytes to write
+		 * @return true if data was written
+		 * @return false if data is larger than a whole region and nothing was written
+		 */
+		bool write_contiguous(const void *src, size_type amount)
+		{
+			if (amount > head.bytes_remaining())
+			{
+				// Don't acquire a region that can't hold it either
+				if (!chain.empty() && amount > chain.back().first.size())
+				{
+					detail::writer_counters::on_failure(amount);
+					return false;
+				}
+				advance();
+			}
+
+			return head.write(src, amount);
+		}
+
+		/**
+		 * @brief Get the unwritten space of the current region, to be filled in place and then committed
+		 *
+		 * @param minimum Minimum number of bytes needed, the next region is acquired if the current one has less
+		 * @return region The unwritten space, smaller than minimum only if minimum is larger than a whole region
+		 */
+		region free_space(size_type minimum = 1)
+		{
+			if (head.bytes_remaining() < minimum && (chain.empty() || head.bytes_written() != 0))
+				advance();
+
+			return region(head.startPtr + head.bytes_written(), head.endPtr);
+		}
+
+		/**
+		 * @brief Mark bytes filled in place at the start of free_space as written
+		 *
+		 * @param amount Number of bytes filled, no more than the free space
+		 */
+		void commit(size_type amount)
+		{
+			assert(amount <= head.bytes_remaining() && "Committed more bytes than the free space of the region");
+			head.reserve(amount);
+		}
+
+		/*! @brief Get the total number of bytes written */
+		size_type bytes_written() const
+		{
+			return completedBytes + head.bytes_written();
+		}
+
+		/*! @brief Get the full size of the current region, 0 before the first region is acquired */
+		size_type region_size() const
+		{
+			return head.size();
+		}
+
+		/**
+		 * @brief Get the scatter list of written data
+		 *
+		 * @return std::vector<region> regions trimmed to the bytes written to them, in write order
+		 */
+		std::vector<region> filled() const
+		{
+			std::vector<region> output;
+			output.reserve(chain.size());
+
+			for (const std::pair<region, size_type> &link : chain)
+				output.emplace_back(link.first.startPtr, link.first.startPtr + link.second);
+
+			if (!output.empty())
+				output.back().endPtr = output.back().startPtr + head.bytes_written();
+
+			return output;
+		}
+
+		/*! @brief Get the full sized regions acquired by the writer, in write order */
+		std::vector<region> regions() const
+		{
+			std::vector<region> output;
+			output.reserve(chain.size());
+
+			for (const std::pair<region, size_type> &link : chain)
+				output.push_back(link.first);
+
+			return output;
+		}
+
+		/**
+		 * @brief Give up ownership of the acquired regions without releasing them, and start over
+		 *
+		 * @return std::vector<region> the full sized regions, the caller must release them to the pool
+		 */
+		std::vector<region> detach()
+		{
+			std::vector<region> output = regions();
+
+			chain.clear();
+			completedBytes = 0;
+			head = memory::writer();
+
+			return output;
+		}
+
+		/*! @brief Release all acquired regions to the pool and start over */
+		void release()
+		{
+			for (const std::pair<region, size_type> &link : chain)
+				resourcePool->release(link.first);
+
+			chain.clear();
+			completedBytes = 0;
+			head = memory::writer();
+		}
+
+	  private:
+		/*! @brief Finish the current region and acquire the next one */
+		void advance()
+		{
+			if (!chain.empty())
+			{
+				chain.back().second = head.bytes_written();
+				completedBytes += head.bytes_written();
+				detail::writer_counters::on_overflow();
+			}
+
+			chain.emplace_back(resourcePool->acquire(), 0);
+			head = memory::writer(chain.back().first);
+		}
+
+		PoolT *resourcePool;
+		/*! @brief Acquired regions and the bytes written to each, the last count is only updated on advance */
+		std::vector<std::pair<region, size_type>> chain;
+		size_type completedBytes = 0;
+		memory::writer head;
+	};
+	/**
+	 * @brief A reader over a chain of regions, eg the scatter list of a ranges::writer
+	 *
+	 * Reads that cross the end of a region continue in the next one
+	 *
+	 * @warning The regions are not owned and must outlive the reader
+	 */
+	struct reader
+	{
+		using size_type = std::size_t;
+
+		/**
+		 * @brief Constructor
+		 *
+		 * @param regions Regions to read, in order
+		 */
+		reader(std::span<const region> regions)
+			: regions(regions), head(regions.empty() ? region() : regions.front())
+		{
+			for (const region &source : regions)
+				totalBytes += source.size();
+		}
+
+		/**
+		 * @brief Read data, gathering it across regions if needed
+		 *
+		 * @param dest Pointer to the destination
+		 * @param amount Number of bytes to read
+		 * @return true if data was read
+		 * @return false if the chain doesn't hold enough data and nothing was read
+		 */
+		bool read(void *dest, size_type amount)
+		{
+			if (!peek(dest, amount))
+				return false;
+			advance(amount);
+			return true;
+		}
+
+		/**
+		 * @brief Read an object, gathering it across regions if needed
+		 *
+		 * @tparam ObjectT Object type
+		 * @param object Object to read into
+		 * @return true if data was read
+		 * @return false if the chain doesn't hold enough data and nothing was read
+		 */
+		template <typename ObjectT>
+		bool read(ObjectT &object) requires(!detail::is_span<ObjectT>::value)
+		{
+			return read(&object, sizeof(ObjectT));
+		}
+
+		/**
+		 * @brief Read a contigious range of objects, gathering it across regions if needed
+		 *
+		 * @param dest Objects to read into
+		 * @return true if data was read
+		 * @return false if the chain doesn't hold enough data and nothing was read
+		 */
+		template <typename ObjectT, std::size_t Extent>
+		bool read(std::span<ObjectT, Extent> dest)
+		{
+			return read(dest.data(), dest.size_bytes());
+		}
+
+		/**
+		 * @brief Read data without advancing
+		 *
+		 * @param dest Pointer to the destination
+		 * @param amount Number of bytes to read
+		 * @return true if data was read
+		 * @return false if the chain doesn't hold enough data and nothing was read
+		 */
+		bool peek(void *dest, size_type amount) const
+		{
+			if (amount > bytes_remaining())
+				return false;
+
+			if (head.bytes_remaining() >= amount)
+				return memory::reader(head).read(dest, amount);
+
+			uint8_t *output = static_cast<uint8_t *>(dest);
+			memory::reader current = head;
+			std::size_t next = index + 1;
+
+			while (amount != 0)
+			{
+				const size_type chunk = std::min(amount, current.bytes_remaining());
+				current.read(output, chunk);
+				output += chunk;
+				amount -= chunk;
+
+				if (amount != 0)
+					current = memory::reader(regions[next++]);
+			}
+			return true;
+		}
+
+		/**
+		 * @brief Read an object without advancing
+		 *
+		 * @tparam ObjectT Object type
+		 * @param object Object to read into
+		 * @return true if data was read
+		 * @return false if the chain doesn't hold enough data and nothing was read
+		 */
+		template <typename ObjectT>
+		bool peek(ObjectT &object) const
+		{
+			return peek(&object, sizeof(ObjectT));
+		}
+
+		/**
+		 * @brief Advance past data without reading it
+		 *
+		 * @param amount Number of bytes to skip
+		 * @return true if data was skipped
+		 * @return false if the chain doesn't hold enough data and nothing was skipped
+		 */
+		bool skip(size_type amount)
+		{
+			if (amount > bytes_remaining())
+				return false;
+			advance(amount);
+			return true;
+		}
+
+		/**
+		 * @brief Advance past data in the current region, returning it as a sub region without copying
+		 *
+		 * @param amount Number of bytes to view
+		 * @param output Region of the viewed data
+		 * @return true if data was viewed
+		 * @return false if the data isn't contigious in one region, nothing was viewed and output is unchanged
+		 */
+		bool view(size_type amount, region &output)
+		{
+			if (head.bytes_remaining() == 0 && amount != 0)
+				next_region();
+
+			if (!head.view(amount, output))
+				return false;
+			bytesRead += amount;
+			return true;
+		}
+
+		/**
+		 * @brief Advance past the unread data of the current region, up to maximum bytes, returning it without copying
+		 *
+		 * @param maximum Maximum number of bytes to view
+		 * @param output Region of the viewed data
+		 * @return true if data was viewed
+		 * @return false if the chain is exhausted, output is unchanged
+		 */
+		bool view_chunk(size_type maximum, region &output)
+		{
+			if (head.bytes_remaining() == 0)
+				next_region();
+
+			const size_type amount = std::min(maximum, head.bytes_remaining());
+			if (amount == 0)
+				return false;
+
+			head.view(amount, output);
+			bytesRead += amount;
+			return true;
+		}
+
+		/*! @brief Get number of unread bytes in the chain */
+		size_type bytes_remaining() const
+		{
+			return totalBytes - bytesRead;
+		}
+
+		/*! @brief Get number of bytes read from the chain */
+		size_type bytes_read() const
+		{
+			return bytesRead;
+		}
+
+	  private:
+		/*! @brief Advance by amount bytes, which must be available */
+		void advance(size_type amount)
+		{
+			bytesRead += amount;
+
+			while (amount != 0)
+			{
+				if (head.bytes_remaining() == 0)
+					next_region();
+
+				const size_type chunk = std::min(amount, head.bytes_remaining());
+				head.skip(chunk);
+				amount -= chunk;
+			}
+		}
+
+		void next_region()
+		{
+			while (index + 1 < regions.size())
+			{
+				head = memory::reader(regions[++index]);
+				if (head.bytes_remaining() != 0)
+					return;
+			}
+		}
+
+		std::span<const region> regions;
+		std::size_t index = 0;
+		memory::reader head;
+		size_type bytesRead = 0;
+		size_type totalBytes = 0;
 	};
 } // namespace ranges
 
@@ -0,0 +1,318 @@
+#pragma once
+#include "util/memory.h"
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include <vector>
+
+#ifdef MEMORY_HAS_NUMA
+#include <sched.h>
+#endif
+
+namespace memory
+{
+namespace detail
+{
+	/**
+	 * @brief Parse a sysfs node or cpu list, eg "0-1" or "0,2-3"
+	 *
+	 * @param path File to read
+	 * @return std::vector<uint32_t> Every listed number in order, empty if the file cannot be read
+	 */
+	inline std::vector<uint32_t> read_sysfs_list(const char *path)
+	{
+		std::vector<uint32_t> output;
+
+		FILE *file = fopen(path, "r");
+		if (!file)
+			return output;
+
+		char text[1024] = {};
+		const std::size_t length = fread(text, 1, sizeof(text) - 1, file);
+		fclose(file);
+
+		for (std::size_t i = 0; i < length;)
+		{
+			char *end = nullptr;
+			const unsigned long first = strtoul(text + i, &end, 10);
+			if (end == text + i)
+			{
+				++i;
+				continue;
+			}
+
+			unsigned long last = first;
+			if (*end == '-')
+				last = strtoul(end + 1, &end, 10);
+
+			for (unsigned long number = first; number <= last; ++number)
+				output.push_back(uint32_t(number));
+			i = end - text;
+		}
+
+		return output;
+	}
+} // namespace detail
+
+/**
+ * @brief Get the ids of the NUMA nodes that have memory, in ascending order
+ *
+ * Read once from /sys/devices/system/node/has_memory, falling back to the online nodes. Ids can be sparse,
+ * eg "0,2" when node 1 is memoryless or offline. Machines without NUMA support report node 0 only
+ */
+inline const std::vector<uint32_t> &numa_nodes()
+{
+	static const std::vector<uint32_t> nodes = [] {
+		std::vector<uint32_t> output;
+#ifdef MEMORY_HAS_NUMA
+		output = detail::read_sysfs_list("/sys/devices/system/node/has_memory");
+		if (output.empty())
+			output = detail::read_sysfs_list("/sys/devices/system/node/online");
+#endif
+		if (output.empty())
+			output.push_back(0);
+		return output;
+	}();
+
+	return nodes;
+}
+
+/*! @brief Get the number of NUMA nodes that have memory, machines without NUMA support report a single node */
+inline uint32_t numa_node_count()
+{
+	return numa_nodes().size();
+}
+
+/**
+ * @brief Get the position of a node id in numa_nodes()
+ *
+ * @param node Node id, eg from current_numa_node() or numa_node_of()
+ * @return uint32_t The index, or 0 for nodes without memory and unknown nodes
+ */
+inline uint32_t numa_node_index(int node)
+{
+	const std::vector<uint32_t> &nodes = numa_nodes();
+	if (node < 0)
+		return 0;
+
+	const auto it = std::ranges::lower_bound(nodes, uint32_t(node));
+	return it != nodes.end() && *it == uint32_t(node) ? uint32_t(it - nodes.begin()) : 0;
+}
+
+/**
+ * @brief Get the NUMA node of the cpu the calling thread is running on
+ *
+ * The thread may be migrated at any time, so this is a placement hint rather than a guarantee
+ */
+inline uint32_t current_numa_node()
+{
+#ifdef MEMORY_HAS_NUMA
+	unsigned cpu = 0;
+	unsigned node = 0;
+#if defined(__GLIBC__) && (__GLIBC__ > 2 || (__GLIBC__ == 2 && __GLIBC_MINOR__ >= 29))
+	// Goes through the vdso, so it's cheap enough to call on every acquire
+	if (getcpu(&cpu, &node) == 0)
+		return node;
+#else
+	if (syscall(SYS_getcpu, &cpu, &node, nullptr) == 0)
+		return node;
+#endif
+#endif
+	return 0;
+}
+
+/**
+ * @brief Get the NUMA node the page holding an address is allocated on
+ *
+ * @param address Address to look up, its page is faulted in if it isn't yet
+ * @return int The node, or -1 if it cannot be determined
+ */
+inline int numa_node_of(const void *address)
+{
+#ifdef MEMORY_HAS_NUMA
+	constexpr unsigned long node_and_address = 1 | 2; // MPOL_F_NODE | MPOL_F_ADDR
+
+	int node = -1;
+	if (syscall(SYS_get_mempolicy, &node, nullptr, 0, address, node_and_address) == 0)
+		return node;
+#else
+	(void)address;
+#endif
+	return -1;
+}
+
+/**
+ * @brief Restrict the calling thread to the cpus of a NUMA node
+ *
+ * Read from /sys/devices/system/node/node<N>/cpulist, binding is best effort
+ *
+ * @param node Id of the NUMA node to run on
+ * @return true if the thread was bound
+ */
+inline bool bind_thread_to_node(uint32_t node)
+{
+#ifdef MEMORY_HAS_NUMA
+	char path[64];
+	snprintf(path, sizeof(path), "/sys/devices/system/node/node%u/cpulist", node);
+
+	cpu_set_t cpus;
+	CPU_ZERO(&cpus);
+	bool any = false;
+
+	for (uint32_t cpu : detail::read_sysfs_list(path))
+		if (cpu < CPU_SETSIZE)
+		{
+			CPU_SET(cpu, &cpus);
+			any = true;
+		}
+
+	return any && sched_setaffinity(0, sizeof(cpus), &cpus) == 0;
+#else
+	(void)node;
+	return false;
+#endif
+}
+
+/**
+ * @brief A pool per NUMA node, acquiring from the pool local to the calling thread
+ *
+ * Every node's slabs are bound to that node, so staging buffers are never on a remote socket.
+ * Released regions go back to the pool of the node they were allocated on, regardless of the releasing thread
+ *
+ * @tparam BackingT Backing store of the pooled regions
+ *
+ * @warning Like resource_pool this is not thread safe, releases all allocated regions on deconstruction
+ */
+template <backing_store BackingT = heap_backing>
+struct basic_numa_resource_pool
+{
+	/*! @brief Pool type of a single node */
+	using pool_type = basic_resource_pool<BackingT>;
+
+	/**
+	 * @brief Constructor, creates one pool per node with memory, see numa_nodes()
+	 *
+	 * Threads on memoryless nodes acquire from the pool of the first node
+	 *
+	 * @param resourceSize The size of allocated regions, this should not be zero
+	 * @param allocationAmount Number of regions to allocate when a node's pool is empty, this should not be zero
+	 * @param options Alignment and page backing of every region, numaNode is set per pool
+	 */
+	basic_numa_resource_pool(std::size_t resourceSize, uint32_t allocationAmount = 1, const resource_options &options = {})
+		: registration(this, &release_callback, &release_range_callback)
+	{
+		const std::vector<uint32_t> &nodes = numa_nodes();
+		pools.reserve(nodes.size());
+
+		for (uint32_t node : nodes)
+		{
+			resource_options nodeOptions = options;
+			// There is nothing to bind to on a single node machine, so keep cheaper heap slabs
+			nodeOptions.numaNode = nodes.size() == 1 ? -1 : int(node);
+			pools.push_back(std::make_unique<pool_type>(resourceSize, allocationAmount, nodeOptions));
+		}
+	}
+
+	basic_numa_resource_pool(const basic_numa_resource_pool &) = delete;
+	basic_numa_resource_pool &operator=(const basic_numa_resource_pool &) = delete;
+
+	/*! @brief Get the number of node pools */
+	uint32_t node_count() const
+	{
+		return pools.size();
+	}
+
+	/**
+	 * @brief Get a node's pool
+	 *
+	 * @param index Position of the node in numa_nodes(), use numa_node_index to look up a node id
+	 */
+	pool_type &node_pool(uint32_t index)
+	{
+		assert(index < pools.size() && "NUMA node index out of range");
+		return *pools[index];
+	}
+
+	/*! @brief Get a node's pool */
+	const pool_type &node_pool(uint32_t index) const
+	{
+		assert(index < pools.size() && "NUMA node index out of range");
+		return *pools[index];
+	}
+
+	/*! @brief Get the pool of the node the calling thread is running on */
+	pool_type &local_pool()
+	{
+		return *pools[numa_node_index(int(current_numa_node()))];
+	}
+
+	/**
+	 * @brief Acquire a region from the pool local to the calling thread
+	 *
+	 * @throws std::system_error if a new slab cannot be bound to the local node
+	 */
+	region acquire()
+	{
+		return local_pool().acquire();
+	}
+
+	/*! @brief Acquire a local region that is released back to its node's pool when the handle is destroyed */
+	pooled_region acquire_pooled()
+	{
+		return pooled_region(acquire(), registration.index());
+	}
+
+	/**
+	 * @brief Release a reserved region to the pool of the node it was allocated on
+	 *
+	 * @param target region to be released
+	 */
+	void release(region target)
+	{
+		owner(target).release(target);
+	}
+
+	/**
+	 * @brief Bulk release regions
+	 *
+	 * @param regionRange A range of regions to be released
+	 */
+	void release(const auto &regionRange)
+	{
+		for (const region &target : regionRange)
+			release(target);
+	}
+
+  private:
+	/*! @brief Find the pool a region was allocated by */
+	pool_type &owner(const region &target)
+	{
+		for (const std::unique_ptr<pool_type> &pool : pools)
+			if (pool->get_allocator().owns(target))
+				return *pool;
+
+		assert(false && "Released region was not acquired from this pool");
+		return local_pool();
+	}
+
+	static void release_callback(void *pool, region target)
+	{
+		static_cast<basic_numa_resource_pool *>(pool)->release(target);
+	}
+
+	static void release_range_callback(void *pool, std::span<region> targets)
+	{
+		static_cast<basic_numa_resource_pool *>(pool)->release(targets);
+	}
+
+	std::vector<std::unique_ptr<pool_type>> pools;
+	detail::pool_registration registration;
+};
+
+/*! @brief A NUMA local pool of heap allocated regions */
+using numa_resource_pool = basic_numa_resource_pool<heap_backing>;
+
+/*! @brief A NUMA local pool of page locked regions */
+using numa_pinned_resource_pool = basic_numa_resource_pool<pinned_backing>;
+
+} // namespace memory
@@ -0,0 +1,219 @@
+#pragma once
+#include "util/memory.h"
+#include <memory>
+#include <utility>
+
+namespace memory
+{
+/**
+ * @brief A pool of fixed size objects laid out densely in slabs
+ *
+ * Slots are carved from slabs owned by a resource allocator, a slot is sizeof(T) rounded up to the alignment of a pointer.
+ * The free list is threaded through the free slots themselves, so no memory is spent on free entries.
+ * New slabs are carved lazily, a slot is only touched once it is first allocated
+ *
+ * @tparam T Object type
+ * @tparam BackingT Backing store of the slabs
+ *
+ * @warning This is not thread safe, and objects still alive when the pool is destroyed are not destructed
+ */
+template <typename T, backing_store BackingT = heap_backing>
+struct basic_object_pool
+{
+	/*! @brief unsigned integer type*/
+	using size_type = std::size_t;
+
+	/*! @brief Alignment of a slot, a free slot holds a pointer */
+	static constexpr size_type slot_alignment = std::max(alignof(T), alignof(void *));
+
+	/*! @brief Size of a slot in bytes */
+	static constexpr size_type slot_size = (std::max(sizeof(T), sizeof(void *)) + slot_alignment - 1) & ~(slot_alignment - 1);
+
+	/**
+	 * @brief Deleter for unique pointers to pooled objects, destroys the object and returns its slot
+	 *
+	 */
+	struct deleter
+	{
+		basic_object_pool *pool = nullptr;
+
+		void operator()(T *object) const
+		{
+			pool->destroy(object);
+		}
+	};
+
+	/*! @brief Unique pointer to a pooled object */
+	using unique_ptr = std::unique_ptr<T, deleter>;
+
+	/**
+	 * @brief Constructor
+	 *
+	 * @param slotsPerSlab Number of slots in each slab, this should not be zero
+	 * @param options Options for every slab, the alignment is raised to the alignment of T if needed
+	 */
+	basic_object_pool(uint32_t slotsPerSlab = 256, resource_options options = {})
+		: allocator(with_slot_alignment(options)), slotsPerSlab(slotsPerSlab)
+	{
+		assert(slotsPerSlab != 0 && "Slots per slab cannot be zero");
+	}
+
+	basic_object_pool(const basic_object_pool &) = delete;
+	basic_object_pool &operator=(const basic_object_pool &) = delete;
+
+	/*! @brief Deconstructor, the slabs are released by the allocator */
+	~basic_object_pool()
+	{
+		// Free slots are poisoned in debug pools, unpoison them before the memory is handed back
+		if constexpr (MEMORY_DEBUG_POOLS)
+		{
+			for (free_slot *slot = freeList; slot;)
+			{
+				detail::asan_unpoison(region(reinterpret_cast<uint8_t *>(slot), slot_size));
+				slot = slot->next;
+			}
+		}
+	}
+
+	/**
+	 * @brief Allocate storage for one object, it is not constructed
+	 *
+	 * @return T* Uninitialized slot
+	 */
+	T *allocate()
+	{
+		++liveCount;
+
+		if (freeList)
+		{
+			free_slot *slot = freeList;
+			if constexpr (MEMORY_DEBUG_POOLS)
+				detail::asan_unpoison(region(reinterpret_cast<uint8_t *>(slot), slot_size));
+
+			freeList = slot->next;
+			return reinterpret_cast<T *>(slot);
+		}
+
+		if (carveNext == carveEnd)
+		{
+			const region slab = allocator.alloc_slab(slot_size * slotsPerSlab);
+			carveNext = slab.startPtr;
+			carveEnd = slab.endPtr;
+		}
+
+		uint8_t *slot = carveNext;
+		carveNext += slot_size;
+		return reinterpret_cast<T *>(slot);
+	}
+
+	/**
+	 * @brief Return the storage of an object to the pool, it must already be destructed
+	 *
+	 * @param object Slot returned by allocate
+	 */
+	void deallocate(T *object)
+	{
+		assert(object && "Cannot deallocate a null object");
+		assert(liveCount != 0 && "More objects deallocated than allocated");
+		--liveCount;
+
+		free_slot *slot = ::new (static_cast<void *>(object)) free_slot{freeList};
+		freeList = slot;
+
+		if constexpr (MEMORY_DEBUG_POOLS)
+			detail::asan_poison(region(reinterpret_cast<uint8_t *>(slot), slot_size));
+	}
+
+	/**
+	 * @brief Construct an object in a pooled slot
+	 *
+	 * @param args Constructor arguments
+	 * @return T* The constructed object, release it with destroy
+	 */
+	template <typename... Args>
+	T *create(Args &&...args)
+	{
+		T *object = allocate();
+		try
+		{
+			return std::construct_at(object, std::forward<Args>(args)...);
+		}
+		catch (...)
+		{
+			deallocate(object);
+			throw;
+		}
+	}
+
+	/**
+	 * @brief Destruct an object and return its slot to the pool
+	 *
+	 * @param object Object returned by create
+	 */
+	void destroy(T *object)
+	{
+		std::destroy_at(object);
+		deallocate(object);
+	}
+
+	/**
+	 * @brief Construct an object owned by a unique pointer, its slot is returned when the pointer resets
+	 *
+	 * @param args Constructor arguments
+	 * @return unique_ptr Owner of the object, it must not outlive the pool
+	 */
+	template <typename... Args>
+	unique_ptr make_unique(Args &&...args)
+	{
+		return unique_ptr(create(std::forward<Args>(args)...), deleter{this});
+	}
+
+	/*! @brief Get the number of allocated slots */
+	size_type size() const
+	{
+		return liveCount;
+	}
+
+	/*! @brief Get the number of slots in every slab */
+	uint32_t get_slots_per_slab() const
+	{
+		return slotsPerSlab;
+	}
+
+	/*! @brief Get the allocator that owns the slabs */
+	const basic_resource_allocator<BackingT> &get_allocator() const
+	{
+		return allocator;
+	}
+
+  private:
+	struct free_slot
+	{
+		free_slot *next;
+	};
+
+	static resource_options with_slot_alignment(resource_options options)
+	{
+		options.alignment = std::max(options.alignment, slot_alignment);
+		return options;
+	}
+
+	basic_resource_allocator<BackingT> allocator;
+	uint32_t slotsPerSlab;
+
+	free_slot *freeList = nullptr;
+	// Unused tail of the newest slab, slots are carved from it once the free list is empty
+	uint8_t *carveNext = nullptr;
+	uint8_t *carveEnd = nullptr;
+	size_type liveCount = 0;
+};
+
+/*! @brief A pool of heap allocated objects */
+template <typename T>
+using object_pool = basic_object_pool<T, heap_backing>;
+
+/*! @brief A pool of objects in page locked memory */
+template <typename T>
+using pinned_object_pool = basic_object_pool<T, pinned_backing>;
+
+} // namespace memory
@@ -0,0 +1,287 @@
+#pragma once
+#include "util/memory.h"
+#include "util/numa.h"
+#include "util/stream_copy.h"
+#include <atomic>
+#include <memory>
+#include <system_error>
+#include <thread>
+
+namespace memory
+{
+/**
+ * @brief Options for parallel_copy and parallel_fill
+ *
+ */
+struct parallel_options
+{
+	/*! @brief Number of threads including the calling one, 0 uses std::thread::hardware_concurrency */
+	uint32_t threadCount = 0;
+	/*! @brief Size of the chunks threads take turns on, small enough to be in flight in the cache */
+	std::size_t chunkSize = streaming_threshold;
+	/*! @brief Fewer threads are used so each gets at least this many bytes, small jobs aren't worth starting threads for */
+	std::size_t minimumPerThread = 4 << 20;
+	/*! @brief Run every chunk on a thread bound to the NUMA node its destination is on */
+	bool numaLocal = true;
+};
+
+namespace detail
+{
+	struct parallel_chunk
+	{
+		uint8_t *dst;
+		const uint8_t *src;
+		std::size_t amount;
+	};
+
+	/**
+	 * @brief Split regions into chunks and run a kernel over them on several threads
+	 *
+	 * Chunks are grouped by the NUMA node of their destination, every worker is bound to a node and drains
+	 * that node's chunks before helping with the others. The calling thread works too
+	 *
+	 * @param dest Destination regions
+	 * @param src Contiguous source, split across the regions in order, or nullptr
+	 * @param options Thread and chunk options
+	 * @param nodeOf Called with a destination region to get the id of its NUMA node, or -1 if unknown
+	 * @param kernel Called with (dst, src, amount) for every chunk
+	 */
+	template <typename NodeOfT, typename KernelT>
+	void run_parallel(std::span<const region> dest, const uint8_t *src, const parallel_options &options, NodeOfT &&nodeOf, KernelT &&kernel)
+	{
+		assert(options.chunkSize != 0 && "Parallel chunk size cannot be zero");
+
+		std::size_t total = 0;
+		for (const region &target : dest)
+			total += target.size();
+
+		uint32_t threadCount = options.threadCount != 0 ? options.threadCount : std::max(std::thread::hardware_concurrency(), 1u);
+		threadCount = uint32_t(std::min<std::size_t>(threadCount, std::max<std::size_t>(total / std::max<std::size_t>(options.minimumPerThread, 1), 1)));
+
+		if (threadCount == 1)
+		{
+			for (const region &target : dest)
+			{
+				kernel(target.startPtr, src, target.size());
+				if (src)
+					src += target.size();
+			}
+			return;
+		}
+
+		const uint32_t groupCount = options.numaLocal ? numa_node_count() : 1;
+		std::vector<std::vector<parallel_chunk>> groups(groupCount);
+
+		for (const region &target : dest)
+		{
+			std::vector<parallel_chunk> &group = groups[groupCount > 1 ? numa_node_index(nodeOf(target)) : 0];
+
+			for (std::size_t offset = 0; offset < target.size(); offset += options.chunkSize)
+				group.push_back(parallel_chunk{target.startPtr + offset, src ? src + offset : nullptr, std::min(options.chunkSize, target.size() - offset)});
+
+			if (src)
+				src += target.size();
+		}
+
+		const std::unique_ptr<std::atomic<std::size_t>[]> cursors(new std::atomic<std::size_t>[groupCount]());
+
+		auto work = [&](uint32_t home) {
+			for (uint32_t i = 0; i < groupCount; ++i)
+			{
+				const uint32_t group = (home + i) % groupCount;
+				for (std::size_t next; (next = cursors[group].fetch_add(1, std::memory_order_relaxed)) < groups[group].size();)
+				{
+					const parallel_chunk &chunk = groups[group][next];
+					kernel(chunk.dst, chunk.src, chunk.amount);
+				}
+			}
+		};
+
+		std::vector<std::thread> workers;
+		workers.reserve(threadCount - 1);
+
+		for (uint32_t i = 1; i < threadCount; ++i)
+		{
+			const uint32_t home = i % groupCount;
+			try
+			{
+				workers.emplace_back([&work, home, groupCount] {
+					if (groupCount > 1)
+						bind_thread_to_node(numa_nodes()[home]);
+					work(home);
+				});
+			}
+			catch (const std::system_error &)
+			{
+				// Out of threads, the ones already running and the calling thread finish the work
+				break;
+			}
+		}
+
+		work(groupCount > 1 ? numa_node_index(int(current_numa_node())) : 0);
+
+		for (std::thread &worker : workers)
+			worker.join();
+	}
+
+	/*! @brief Look up the NUMA node of every destination region, one page lookup per region */
+	inline int page_node_of(const region &target)
+	{
+		return numa_node_of(target.startPtr);
+	}
+
+	/**
+	 * @brief Look up the NUMA node of regions once per slab of the allocators that carved them
+	 *
+	 * Slabs bound to a node report it without a lookup, others are looked up at their first page.
+	 * Regions outside every slab are looked up at their own first page
+	 *
+	 * @tparam BackingT Backing store of the slabs
+	 */
+	template <backing_store BackingT>
+	struct slab_node_lookup
+	{
+		using allocator_type = basic_resource_allocator<BackingT>;
+
+		/*! @brief Node of a slab that hasn't been looked up yet */
+		static constexpr int unknown = -2;
+
+		void add(const allocator_type &allocator)
+		{
+			allocators.push_back(&allocator);
+			nodes.emplace_back(allocator.slab_count(), unknown);
+		}
+
+		int operator()(const region &target)
+		{
+			for (std::size_t i = 0; i < allocators.size(); ++i)
+			{
+				const std::size_t index = allocators[i]->find_slab(target);
+				if (index == allocator_type::npos)
+					continue;
+
+				int &node = nodes[i][index];
+				if (node == unknown)
+				{
+					const basic_resource<BackingT> &slab = allocators[i]->get_slabs()[index];
+					node = slab.get_options().numaNode >= 0 ? slab.get_options().numaNode : numa_node_of(slab.get_pointer());
+				}
+				return node;
+			}
+
+			return numa_node_of(target.startPtr);
+		}
+
+	  private:
+		std::vector<const allocator_type *> allocators;
+		std::vector<std::vector<int>> nodes;
+	};
+
+	/*! @brief Get the NUMA node lookup of the regions of a pool */
+	template <typename PoolT>
+	auto pool_node_lookup(const PoolT &pool) requires requires { pool.get_allocator(); }
+	{
+		slab_node_lookup<typename std::remove_cvref_t<decltype(pool.get_allocator())>::value_type::backing_type> lookup;
+		lookup.add(pool.get_allocator());
+		return lookup;
+	}
+
+	template <backing_store BackingT>
+	slab_node_lookup<BackingT> pool_node_lookup(const basic_numa_resource_pool<BackingT> &pool)
+	{
+		slab_node_lookup<BackingT> lookup;
+		for (uint32_t index = 0; index < pool.node_count(); ++index)
+			lookup.add(pool.node_pool(index).get_allocator());
+		return lookup;
+	}
+
+	template <typename NodeOfT>
+	void copy_regions(std::span<const region> dest, const void *src, const parallel_options &options, NodeOfT &&nodeOf)
+	{
+		std::size_t total = 0;
+		for (const region &target : dest)
+			total += target.size();
+
+		if (total >= streaming_threshold)
+			run_parallel(dest, static_cast<const uint8_t *>(src), options, nodeOf, [](uint8_t *dst, const uint8_t *from, std::size_t amount) { stream_copy(dst, from, amount); });
+		else
+			run_parallel(dest, static_cast<const uint8_t *>(src), options, nodeOf, [](uint8_t *dst, const uint8_t *from, std::size_t amount) { memcpy(dst, from, amount); });
+	}
+
+	template <typename NodeOfT>
+	void fill_regions(std::span<const region> dest, uint8_t value, const parallel_options &options, NodeOfT &&nodeOf)
+	{
+		std::size_t total = 0;
+		for (const region &target : dest)
+			total += target.size();
+
+		if (total >= streaming_threshold)
+			run_parallel(dest, nullptr, options, nodeOf, [value](uint8_t *dst, const uint8_t *, std::size_t amount) { stream_fill(dst, value, amount); });
+		else
+			run_parallel(dest, nullptr, options, nodeOf, [value](uint8_t *dst, const uint8_t *, std::size_t amount) { memset(dst, value, amount); });
+	}
+} // namespace detail
+
+/**
+ * @brief Copy a contiguous source into a list of regions on several threads
+ *
+ * Large copies use non temporal stores, so the destination doesn't evict the cache.
+ * The NUMA node of every region is looked up separately, pass the pool the regions came from to look up each slab once
+ *
+ * @param dest Destination regions, filled in order
+ * @param src Source holding the combined size of the regions
+ * @param options Thread and chunk options
+ */
+inline void parallel_copy(std::span<const region> dest, const void *src, const parallel_options &options = {})
+{
+	detail::copy_regions(dest, src, options, &detail::page_node_of);
+}
+
+/**
+ * @brief Copy a contiguous source into a list of pooled regions on several threads
+ *
+ * The NUMA node of the regions is looked up once per slab of the pool
+ *
+ * @param dest Destination regions, filled in order
+ * @param src Source holding the combined size of the regions
+ * @param pool Pool the regions were acquired from, eg a resource_pool or numa_resource_pool
+ * @param options Thread and chunk options
+ */
+template <typename PoolT>
+void parallel_copy(std::span<const region> dest, const void *src, const PoolT &pool, const parallel_options &options = {}) requires requires { detail::pool_node_lookup(pool); }
+{
+	detail::copy_regions(dest, src, options, detail::pool_node_lookup(pool));
+}
+
+/**
+ * @brief Fill a list of regions on several threads
+ *
+ * Large fills use non temporal stores, so the destination doesn't evict the cache.
+ * The NUMA node of every region is looked up separately, pass the pool the regions came from to look up each slab once
+ *
+ * @param dest Destination regions
+ * @param value Byte to fill with
+ * @param options Thread and chunk options
+ */
+inline void parallel_fill(std::span<const region> dest, uint8_t value, const parallel_options &options = {})
+{
+	detail::fill_regions(dest, value, options, &detail::page_node_of);
+}
+
+/**
+ * @brief Fill a list of pooled regions on several threads
+ *
+ * The NUMA node of the regions is looked up once per slab of the pool
+ *
+ * @param dest Destination regions
+ * @param value Byte to fill with
+ * @param pool Pool the regions were acquired from, eg a resource_pool or numa_resource_pool
+ * @param options Thread and chunk options
+ */
+template <typename PoolT>
+void parallel_fill(std::span<const region> dest, uint8_t value, const PoolT &pool, const parallel_options &options = {}) requires requires { detail::pool_node_lookup(pool); }
+{
+	detail::fill_regions(dest, value, options, detail::pool_node_lookup(pool));
+}
+
+} // namespace memory
@@ -22,7 +22,7 @@ inline void append_range(DestinationT &&dest, const SourceT &src) requires
 {
 	assert(src.size() != 0 && "Attempt to append empty range");
 
-	const uint32_t originalSize = dest.size();
+	const std::size_t originalSize = dest.size();
 	dest.resize(dest.size() + src.size());
 
 	std::copy(src.begin(), src.end(), dest.begin() + originalSize);
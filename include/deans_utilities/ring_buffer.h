@@ -0,0 +1,173 @@
+#pragma once
+#include "util/memory.h"
+#include <deque>
+
+namespace memory
+{
+/**
+ * @brief A ring of staging memory for frame pipelined uploads
+ *
+ * Contiguous regions are carved from one resource in FIFO order, wrapping around at the end. Every frame
+ * is closed with a fence value, eg a timeline semaphore value, and its space is reclaimed once that fence
+ * has completed. Memory use never exceeds the capacity, allocation fails instead
+ *
+ * @tparam BackingT Backing store of the ring, use pinned_backing for memory that is DMA'd directly
+ *
+ * @warning This is not thread safe
+ */
+template <backing_store BackingT = heap_backing>
+struct basic_ring_buffer
+{
+	/*! @brief unsigned integer type*/
+	using size_type = std::size_t;
+
+	/**
+	 * @brief Constructor
+	 *
+	 * @param capacity Size of the ring in bytes, this should not be zero
+	 * @param options Alignment and page backing of the ring, allocations can be aligned up to options.alignment
+	 */
+	basic_ring_buffer(size_type capacity, const resource_options &options = {})
+		: memory(capacity, options), capacity(capacity)
+	{
+	}
+
+	/**
+	 * @brief Allocate a contiguous region in the current frame
+	 *
+	 * If the region doesn't fit before the end of the ring the remaining space is skipped and it starts at the front
+	 *
+	 * @param size Size of the region in bytes, no larger than the capacity
+	 * @param alignment Alignment of the region, a power of two no larger than the ring's alignment
+	 * @return region The allocated region, or an empty region if the ring is out of space and nothing was allocated
+	 */
+	region allocate(size_type size, size_type alignment = 1)
+	{
+		assert(size <= capacity && "Allocation is larger than the ring");
+		assert(alignment <= memory.get_options().alignment && "Allocation alignment exceeds the alignment of the ring");
+
+		// Nothing is live, so start again at the front rather than wrapping
+		if (head == tail && frames.empty())
+			head = tail = 0;
+
+		const size_type offset = tail % capacity;
+		size_type start = aligned_size(offset, alignment);
+		uint64_t skipped = start - offset;
+
+		// Wrap to the front, the tail of the ring is skipped until this frame is reclaimed
+		if (start + size > capacity)
+		{
+			skipped = capacity - offset;
+			start = 0;
+		}
+
+		const uint64_t end = tail + skipped + size;
+		if (end - head > capacity)
+			return region();
+
+		tail = end;
+		return region(memory.get_pointer() + start, size);
+	}
+
+	/**
+	 * @brief Allocate a region in the current frame and get a writer over it
+	 *
+	 * @param size Size of the region in bytes
+	 * @param alignment Alignment of the region
+	 * @return writer Writer over the region, empty if the ring is out of space
+	 */
+	writer allocate_writer(size_type size, size_type alignment = 1)
+	{
+		return writer(allocate(size, alignment));
+	}
+
+	/**
+	 * @brief Close the current frame
+	 *
+	 * A frame without allocations records nothing, so earlier frames keep their own fences
+	 *
+	 * @param fence Fence value that signals once the frame's regions are no longer in use, values must not decrease
+	 */
+	void end_frame(uint64_t fence)
+	{
+		assert((frames.empty() || frames.back().fence <= fence) && "Frame fences must not decrease");
+
+		if (tail == (frames.empty() ? head : frames.back().end))
+			return;
+
+		frames.push_back(frame{fence, tail});
+	}
+
+	/**
+	 * @brief Reclaim the space of every closed frame whose fence has completed, in FIFO order
+	 *
+	 * @param completedFence Most recent completed fence value
+	 * @return size_type Number of bytes reclaimed
+	 */
+	size_type reclaim(uint64_t completedFence)
+	{
+		const uint64_t oldHead = head;
+
+		while (!frames.empty() && frames.front().fence <= completedFence)
+		{
+			head = frames.front().end;
+			frames.pop_front();
+		}
+
+		return head - oldHead;
+	}
+
+	/*! @brief Get the number of bytes allocated and not yet reclaimed, including skipped space */
+	size_type bytes_used() const
+	{
+		return tail - head;
+	}
+
+	/*! @brief Get the number of bytes available, an allocation may fail earlier if it would wrap */
+	size_type bytes_remaining() const
+	{
+		return capacity - bytes_used();
+	}
+
+	/*! @brief Get the size of the ring in bytes */
+	size_type get_capacity() const
+	{
+		return capacity;
+	}
+
+	/*! @brief Get the number of closed frames that haven't been reclaimed */
+	size_type frames_in_flight() const
+	{
+		return frames.size();
+	}
+
+	/*! @brief Get the resource backing the ring, eg to register it with a device */
+	const basic_resource<BackingT> &get_resource() const
+	{
+		return memory;
+	}
+
+  private:
+	struct frame
+	{
+		uint64_t fence;
+		/*! @brief Ring position after the frame's last allocation */
+		uint64_t end;
+	};
+
+	basic_resource<BackingT> memory;
+	size_type capacity;
+
+	// Positions increase monotonically, the ring offset is position % capacity
+	uint64_t head = 0;
+	uint64_t tail = 0;
+	std::deque<frame> frames;
+};
+
+/*! @brief A ring of heap allocated staging memory */
+using ring_buffer = basic_ring_buffer<heap_backing>;
+
+/*! @brief A ring of page locked staging memory, for direct transfers to the gpu */
+using pinned_ring_buffer = basic_ring_buffer<pinned_backing>;
+
+} // namespace memory
@@ -0,0 +1,300 @@
+#pragma once
+#include "util/memory.h"
+#include <bit>
+#include <stdexcept>
+
+namespace memory
+{
+/**
+ * @brief A pool of power of two sized regions, for staging buffers of varying size
+ *
+ * Requests are routed to the smallest class that fits in constant time. Every class is carved from the same
+ * slabs as a buddy allocator: an empty class halves a free region of a larger class before a new slab is allocated,
+ * and a released region is merged with its buddy while the buddy is free, so memory flows back up to the larger classes
+ *
+ * Free regions are linked through their first bytes, with a bitmap per slab marking which are free
+ *
+ * @tparam BackingT Backing store of the slabs, it must be host writable
+ *
+ * @warning Releases all allocated regions on deconstruction
+ */
+template <backing_store BackingT = heap_backing>
+struct basic_size_class_pool
+{
+	/*! @brief Smallest class size, a free region holds the links of its free list */
+	static constexpr std::size_t min_region_size = 2 * sizeof(void *);
+
+	/**
+	 * @brief Constructor
+	 *
+	 * @param minClassSize Size of the smallest class, a power of two of at least min_region_size
+	 * @param maxClassSize Size of the largest class, a power of two no smaller than minClassSize
+	 * @param slabSize Size of every slab, rounded up to a multiple of maxClassSize
+	 * @param options Alignment and page backing of the slabs, the alignment is raised to maxClassSize so buddies can be found by address
+	 */
+	basic_size_class_pool(std::size_t minClassSize, std::size_t maxClassSize, std::size_t slabSize = 0, const resource_options &options = {})
+		: minShift(std::countr_zero(minClassSize)),
+		  slabSize(aligned_size(std::max(slabSize, maxClassSize), maxClassSize)),
+		  freeLists(std::countr_zero(maxClassSize) - std::countr_zero(minClassSize) + 1, nullptr),
+		  bitOffsets(freeLists.size() + 1, 0),
+		  allocator(with_block_alignment(options, maxClassSize)),
+		  registration(this, &release_callback, &release_range_callback)
+	{
+		assert(std::has_single_bit(minClassSize) && "Minimum class size must be a power of two");
+		assert(std::has_single_bit(maxClassSize) && "Maximum class size must be a power of two");
+		assert(minClassSize <= maxClassSize && "Minimum class size cannot exceed the maximum class size");
+		assert(minClassSize >= min_region_size && "Minimum class size is too small to link free regions");
+
+		// Every class has one free bit per region of that class in a slab
+		for (uint32_t index = 0; index < class_count(); ++index)
+			bitOffsets[index + 1] = bitOffsets[index] + (this->slabSize >> (minShift + index));
+	}
+
+	basic_size_class_pool(const basic_size_class_pool &) = delete;
+	basic_size_class_pool &operator=(const basic_size_class_pool &) = delete;
+
+	/**
+	 * @brief Get the class a size is routed to
+	 *
+	 * @param bytes Requested size in bytes, no larger than max_class_size()
+	 * @return uint32_t Index of the smallest class that fits bytes
+	 */
+	uint32_t class_index(std::size_t bytes) const
+	{
+		assert(bytes <= max_class_size() && "Requested size exceeds the largest class");
+
+		const uint32_t shift = bytes <= 1 ? 0 : std::bit_width(bytes - 1);
+		return shift <= minShift ? 0 : shift - minShift;
+	}
+
+	/*! @brief Get the size of regions in a class */
+	std::size_t class_size(uint32_t index) const
+	{
+		return std::size_t(1) << (minShift + index);
+	}
+
+	/*! @brief Get the number of classes */
+	uint32_t class_count() const
+	{
+		return freeLists.size();
+	}
+
+	/*! @brief Get the size of the largest class */
+	std::size_t max_class_size() const
+	{
+		return class_size(class_count() - 1);
+	}
+
+	/**
+	 * @brief Acquire a region of at least bytes
+	 *
+	 * @param bytes Requested size in bytes, no larger than max_class_size()
+	 * @return region Region of class_size(class_index(bytes)) bytes
+	 * @throws std::length_error if bytes exceeds max_class_size()
+	 */
+	region acquire(std::size_t bytes)
+	{
+		if (bytes > max_class_size())
+			throw std::length_error("Requested size exceeds the largest size class");
+
+		const uint32_t index = class_index(bytes);
+
+		if (!freeLists[index])
+			refill(index);
+
+		free_node *node = freeLists[index];
+		unlink(node, index, find_slab(reinterpret_cast<uint8_t *>(node)));
+		return region(reinterpret_cast<uint8_t *>(node), class_size(index));
+	}
+
+	/**
+	 * @brief Acquire a region of at least bytes that is released back to the pool when the handle is destroyed
+	 *
+	 * @param bytes Requested size in bytes, no larger than max_class_size()
+	 * @throws std::length_error if bytes exceeds max_class_size()
+	 */
+	pooled_region acquire_pooled(std::size_t bytes)
+	{
+		return pooled_region(acquire(bytes), registration.index());
+	}
+
+	/**
+	 * @brief Release a reserved region, its class is taken from its size
+	 *
+	 * The region is merged with its buddy for as long as the buddy is free, up to the largest class
+	 *
+	 * @param target region to be released
+	 *
+	 * @warning this does not check if region is acquired
+	 */
+	void release(region target)
+	{
+		assert(std::has_single_bit(target.size()) && "Released region was not acquired from a size class pool");
+
+		uint32_t index = class_index(target.size());
+		uint8_t *start = target.startPtr;
+		slab_state &slab = find_slab(start);
+
+		// Blocks of the largest class are aligned to its size, so a buddy is found by flipping the size bit of the address
+		for (; index + 1 < class_count(); ++index)
+		{
+			uint8_t *buddy = reinterpret_cast<uint8_t *>(reinterpret_cast<std::uintptr_t>(start) ^ class_size(index));
+			if (!is_free(slab, buddy, index))
+				break;
+
+			unlink(reinterpret_cast<free_node *>(buddy), index, slab);
+			start = std::min(start, buddy);
+		}
+
+		link(start, index, slab);
+	}
+
+	/**
+	 * @brief Bulk release regions
+	 *
+	 * @param regionRange A range of regions to be released
+	 */
+	void release(const auto &regionRange)
+	{
+		for (const region &target : regionRange)
+			release(target);
+	}
+
+  private:
+	/*! @brief Links of a free region, stored in its first bytes */
+	struct free_node
+	{
+		free_node *prev;
+		free_node *next;
+	};
+
+	/*! @brief Free bits of a slab, one per region of every class */
+	struct slab_state
+	{
+		uint8_t *start;
+		std::vector<uint64_t> freeBits;
+	};
+
+	static resource_options with_block_alignment(resource_options options, std::size_t maxClassSize)
+	{
+		options.alignment = std::max(options.alignment, maxClassSize);
+		return options;
+	}
+
+	/**
+	 * @brief Fill an empty class by halving the smallest larger free region, carving a new slab if there is none
+	 *
+	 * @param index Index of the empty class
+	 */
+	void refill(uint32_t index)
+	{
+		uint32_t larger = index + 1;
+		while (larger < class_count() && !freeLists[larger])
+			++larger;
+
+		if (larger == class_count())
+		{
+			larger = class_count() - 1;
+			add_slab();
+
+			if (larger == index)
+				return;
+		}
+
+		uint8_t *source = reinterpret_cast<uint8_t *>(freeLists[larger]);
+		slab_state &slab = find_slab(source);
+		unlink(freeLists[larger], larger, slab);
+
+		// Keep the upper half free in every class on the way down
+		for (uint32_t current = larger; current > index; --current)
+			link(source + class_size(current - 1), current - 1, slab);
+
+		link(source, index, slab);
+	}
+
+	/*! @brief Allocate a slab, every block of the largest class in it is free */
+	void add_slab()
+	{
+		const region memory = allocator.alloc_slab(slabSize);
+		const uint8_t *start = memory.startPtr;
+
+		auto position = std::ranges::upper_bound(slabs, start, {}, &slab_state::start);
+		slab_state &slab = *slabs.insert(position, slab_state{memory.startPtr, std::vector<uint64_t>((bitOffsets.back() + 63) / 64, 0)});
+
+		const uint32_t top = class_count() - 1;
+		for (uint8_t *block = memory.endPtr; block != memory.startPtr;)
+			link(block -= max_class_size(), top, slab);
+	}
+
+	/*! @brief Find the slab holding an address, it must be inside one */
+	slab_state &find_slab(const uint8_t *address)
+	{
+		auto it = std::ranges::upper_bound(slabs, address, {}, &slab_state::start);
+		assert(it != slabs.begin() && "Region was not allocated by this size class pool");
+		return *--it;
+	}
+
+	std::size_t bit_index(const slab_state &slab, const uint8_t *start, uint32_t index) const
+	{
+		return bitOffsets[index] + (std::size_t(start - slab.start) >> (minShift + index));
+	}
+
+	bool is_free(const slab_state &slab, const uint8_t *start, uint32_t index) const
+	{
+		const std::size_t bit = bit_index(slab, start, index);
+		return slab.freeBits[bit / 64] & (uint64_t(1) << (bit % 64));
+	}
+
+	/*! @brief Push a region onto the free list of its class */
+	void link(uint8_t *start, uint32_t index, slab_state &slab)
+	{
+		const std::size_t bit = bit_index(slab, start, index);
+		slab.freeBits[bit / 64] |= uint64_t(1) << (bit % 64);
+
+		free_node *node = ::new (static_cast<void *>(start)) free_node{nullptr, freeLists[index]};
+		if (node->next)
+			node->next->prev = node;
+		freeLists[index] = node;
+	}
+
+	/*! @brief Remove a free region from the free list of its class */
+	void unlink(free_node *node, uint32_t index, slab_state &slab)
+	{
+		const std::size_t bit = bit_index(slab, reinterpret_cast<uint8_t *>(node), index);
+		slab.freeBits[bit / 64] &= ~(uint64_t(1) << (bit % 64));
+
+		if (node->prev)
+			node->prev->next = node->next;
+		else
+			freeLists[index] = node->next;
+
+		if (node->next)
+			node->next->prev = node->prev;
+	}
+
+	static void release_callback(void *pool, region target)
+	{
+		static_cast<basic_size_class_pool *>(pool)->release(target);
+	}
+
+	static void release_range_callback(void *pool, std::span<region> targets)
+	{
+		static_cast<basic_size_class_pool *>(pool)->release(targets);
+	}
+
+	uint32_t minShift;
+	std::size_t slabSize;
+	std::vector<free_node *> freeLists;
+	/*! @brief Offset of every class in the free bits of a slab */
+	std::vector<std::size_t> bitOffsets;
+	/*! @brief Sorted by address */
+	std::vector<slab_state> slabs;
+
+	basic_resource_allocator<BackingT> allocator;
+	detail::pool_registration registration;
+};
+
+/*! @brief A size class pool of heap allocated regions */
+using size_class_pool = basic_size_class_pool<heap_backing>;
+
+} // namespace memory
@@ -0,0 +1,498 @@
+#pragma once
+#include "util/memory.h"
+#include <compare>
+#include <iterator>
+#include <span>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+
+namespace memory
+{
+namespace detail
+{
+	/**
+	 * @brief Reference to one element of a struct of arrays, made of references to each of its fields
+	 *
+	 * Assigning through a soa_reference writes the fields, it never rebinds them
+	 *
+	 * @tparam Ts Field types, const for a read only reference
+	 */
+	template <typename... Ts>
+	struct soa_reference
+	{
+		/*! @brief Element type the reference refers to */
+		using value_type = std::tuple<std::remove_const_t<Ts>...>;
+
+		soa_reference(Ts &...fields)
+			: fields(fields...)
+		{
+		}
+
+		soa_reference(const soa_reference &other) = default;
+
+		/*! @brief Copy the fields of another element */
+		const soa_reference &operator=(const soa_reference &other) const
+			requires(!(std::is_const_v<Ts> || ...))
+		{
+			assign(other.fields, std::index_sequence_for<Ts...>{});
+			return *this;
+		}
+
+		/*! @brief Copy the fields of another element, eg from a read only reference */
+		template <typename... Us>
+		const soa_reference &operator=(const soa_reference<Us...> &other) const
+			requires(!(std::is_const_v<Ts> || ...))
+		{
+			assign(other.fields, std::index_sequence_for<Ts...>{});
+			return *this;
+		}
+
+		/*! @brief Copy every field from a tuple */
+		const soa_reference &operator=(const value_type &value) const
+			requires(!(std::is_const_v<Ts> || ...))
+		{
+			assign(value, std::index_sequence_for<Ts...>{});
+			return *this;
+		}
+
+		/*! @brief Copy the element out */
+		operator value_type() const
+		{
+			return value_type(fields);
+		}
+
+		/*! @brief Get a reference to a field */
+		template <std::size_t I>
+		std::tuple_element_t<I, std::tuple<Ts...>> &get() const
+		{
+			return std::get<I>(fields);
+		}
+
+	  private:
+		template <typename...>
+		friend struct soa_reference;
+
+		template <typename TupleT, std::size_t... Is>
+		void assign(const TupleT &src, std::index_sequence<Is...>) const
+		{
+			((std::get<Is>(fields) = std::get<Is>(src)), ...);
+		}
+
+		std::tuple<Ts &...> fields;
+	};
+
+	/**
+	 * @brief Random access iterator over the elements of a struct of arrays
+	 *
+	 * @tparam Ts Field types, const for a read only iterator
+	 */
+	template <typename... Ts>
+	struct soa_iterator
+	{
+		using iterator_concept = std::random_access_iterator_tag;
+		// Dereferencing yields a proxy, so only input iterator requirements are met for legacy algorithms
+		using iterator_category = std::input_iterator_tag;
+		using value_type = std::tuple<std::remove_const_t<Ts>...>;
+		using difference_type = std::ptrdiff_t;
+		using reference = soa_reference<Ts...>;
+
+		soa_iterator() = default;
+
+		soa_iterator(const std::tuple<Ts *...> &columns, difference_type index)
+			: columns(columns), index(index)
+		{
+		}
+
+		/*! @brief Convert to a read only iterator */
+		operator soa_iterator<const Ts...>() const
+			requires(!(std::is_const_v<Ts> && ...))
+		{
+			return soa_iterator<const Ts...>(std::apply([](Ts *...column) { return std::tuple<const Ts *...>(column...); }, columns), index);
+		}
+
+		reference operator*() const
+		{
+			return std::apply([this](Ts *...column) { return reference(column[index]...); }, columns);
+		}
+
+		reference operator[](difference_type offset) const
+		{
+			return *(*this + offset);
+		}
+
+		soa_iterator &operator++()
+		{
+			++index;
+			return *this;
+		}
+
+		soa_iterator operator++(int)
+		{
+			soa_iterator old = *this;
+			++index;
+			return old;
+		}
+
+		soa_iterator &operator--()
+		{
+			--index;
+			return *this;
+		}
+
+		soa_iterator operator--(int)
+		{
+			soa_iterator old = *this;
+			--index;
+			return old;
+		}
+
+		soa_iterator &operator+=(difference_type offset)
+		{
+			index += offset;
+			return *this;
+		}
+
+		soa_iterator &operator-=(difference_type offset)
+		{
+			index -= offset;
+			return *this;
+		}
+
+		friend soa_iterator operator+(soa_iterator it, difference_type offset)
+		{
+			return it += offset;
+		}
+
+		friend soa_iterator operator+(difference_type offset, soa_iterator it)
+		{
+			return it += offset;
+		}
+
+		friend soa_iterator operator-(soa_iterator it, difference_type offset)
+		{
+			return it -= offset;
+		}
+
+		friend difference_type operator-(const soa_iterator &lhs, const soa_iterator &rhs)
+		{
+			return lhs.index - rhs.index;
+		}
+
+		bool operator==(const soa_iterator &other) const
+		{
+			return index == other.index;
+		}
+
+		std::strong_ordering operator<=>(const soa_iterator &other) const
+		{
+			return index <=> other.index;
+		}
+
+	  private:
+		std::tuple<Ts *...> columns{};
+		difference_type index = 0;
+	};
+} // namespace detail
+
+/**
+ * @brief A growable struct of arrays, every field is stored in its own cache line aligned column
+ *
+ * All columns share one resource, each column starts on a cache line so loops over a single field stream
+ * through contiguous aligned memory. Growing allocates a bigger resource and copies every column over
+ *
+ * @tparam BackingT Backing store of the columns
+ * @tparam Ts Field types, they must be trivially copyable
+ *
+ * @warning This is not thread safe, growing invalidates spans, references and iterators
+ */
+template <backing_store BackingT, typename... Ts>
+struct basic_soa_vector
+{
+	static_assert(sizeof...(Ts) != 0, "A struct of arrays needs at least one field");
+	static_assert((std::is_trivially_copyable_v<Ts> && ...), "Struct of arrays fields must be trivially copyable");
+
+	/*! @brief unsigned integer type*/
+	using size_type = std::size_t;
+	using difference_type = std::ptrdiff_t;
+	using value_type = std::tuple<Ts...>;
+	using reference = detail::soa_reference<Ts...>;
+	using const_reference = detail::soa_reference<const Ts...>;
+	using iterator = detail::soa_iterator<Ts...>;
+	using const_iterator = detail::soa_iterator<const Ts...>;
+
+	/*! @brief Type of a field */
+	template <size_type I>
+	using field_type = std::tuple_element_t<I, value_type>;
+
+	/*! @brief Alignment of the start of every column */
+	static constexpr size_type column_alignment = cache_line_size;
+
+	/**
+	 * @brief Constructor
+	 *
+	 * @param options Options for the resource backing the columns, the alignment is raised to column_alignment
+	 */
+	basic_soa_vector(const resource_options &options = {})
+		: options(with_column_alignment(options))
+	{
+	}
+
+	/**
+	 * @brief Constructor, with value initialized elements
+	 *
+	 * @param count Number of elements
+	 * @param options Options for the resource backing the columns
+	 */
+	basic_soa_vector(size_type count, const resource_options &options = {})
+		: basic_soa_vector(options)
+	{
+		resize(count);
+	}
+
+	basic_soa_vector(basic_soa_vector &&other) noexcept
+		: storage(std::move(other.storage)), columns(std::exchange(other.columns, {})), count(std::exchange(other.count, 0)),
+		  capacity(std::exchange(other.capacity, 0)), options(other.options)
+	{
+	}
+
+	basic_soa_vector &operator=(basic_soa_vector &&other) noexcept
+	{
+		if (this != &other)
+		{
+			storage = std::move(other.storage);
+			columns = std::exchange(other.columns, {});
+			count = std::exchange(other.count, 0);
+			capacity = std::exchange(other.capacity, 0);
+			options = other.options;
+		}
+		return *this;
+	}
+
+	basic_soa_vector(const basic_soa_vector &) = delete;
+	basic_soa_vector &operator=(const basic_soa_vector &) = delete;
+
+	/**
+	 * @brief Make room for at least newCapacity elements
+	 *
+	 * @param newCapacity Number of elements
+	 */
+	void reserve(size_type newCapacity)
+	{
+		if (newCapacity <= capacity)
+			return;
+
+		basic_resource<BackingT> newStorage(layout_size(newCapacity), options);
+		std::tuple<Ts *...> newColumns = carve_columns(newStorage.get_pointer(), newCapacity, std::index_sequence_for<Ts...>{});
+
+		if (count != 0)
+			copy_columns(newColumns, std::index_sequence_for<Ts...>{});
+
+		storage = std::move(newStorage);
+		columns = newColumns;
+		capacity = newCapacity;
+	}
+
+	/**
+	 * @brief Change the number of elements, new elements are value initialized
+	 *
+	 * @param newSize Number of elements
+	 */
+	void resize(size_type newSize)
+	{
+		if (newSize > capacity)
+			grow(newSize);
+
+		if (newSize > count)
+		{
+			std::apply(
+				[this, newSize](Ts *...column) { (std::uninitialized_value_construct(column + count, column + newSize), ...); },
+				columns);
+		}
+
+		count = newSize;
+	}
+
+	/**
+	 * @brief Append an element
+	 *
+	 * @param values Value of every field
+	 */
+	void push_back(const Ts &...values)
+	{
+		if (count == capacity)
+			grow(count + 1);
+
+		std::apply([this, &values...](Ts *...column) { (std::construct_at(column + count, values), ...); }, columns);
+		++count;
+	}
+
+	/*! @brief Append an element from a tuple */
+	void push_back(const value_type &value)
+	{
+		std::apply([this](const Ts &...values) { push_back(values...); }, value);
+	}
+
+	/*! @brief Remove the last element */
+	void pop_back()
+	{
+		assert(count != 0 && "Attempt to pop an empty soa_vector");
+		--count;
+	}
+
+	/*! @brief Remove every element, the capacity is kept */
+	void clear()
+	{
+		count = 0;
+	}
+
+	/*! @brief Get the number of elements */
+	size_type size() const
+	{
+		return count;
+	}
+
+	/*! @brief Get the number of elements that fit without growing */
+	size_type get_capacity() const
+	{
+		return capacity;
+	}
+
+	/*! @brief Check if there are no elements */
+	bool empty() const
+	{
+		return count == 0;
+	}
+
+	/**
+	 * @brief Get a column
+	 *
+	 * @tparam I Index of the field
+	 * @return std::span Every value of the field, aligned to column_alignment
+	 */
+	template <size_type I>
+	std::span<field_type<I>> column()
+	{
+		return std::span<field_type<I>>(std::get<I>(columns), count);
+	}
+
+	/*! @brief Get a read only column */
+	template <size_type I>
+	std::span<const field_type<I>> column() const
+	{
+		return std::span<const field_type<I>>(std::get<I>(columns), count);
+	}
+
+	reference operator[](size_type index)
+	{
+		assert(index < count && "soa_vector index out of range");
+		return begin()[index];
+	}
+
+	const_reference operator[](size_type index) const
+	{
+		assert(index < count && "soa_vector index out of range");
+		return begin()[index];
+	}
+
+	iterator begin()
+	{
+		return iterator(columns, 0);
+	}
+
+	iterator end()
+	{
+		return iterator(columns, count);
+	}
+
+	const_iterator begin() const
+	{
+		return const_columns_iterator(0);
+	}
+
+	const_iterator end() const
+	{
+		return const_columns_iterator(count);
+	}
+
+  private:
+	static resource_options with_column_alignment(resource_options options)
+	{
+		options.alignment = std::max(options.alignment, column_alignment);
+		return options;
+	}
+
+	static size_type layout_size(size_type elementCapacity)
+	{
+		return (aligned_size(elementCapacity * sizeof(Ts), column_alignment) + ...);
+	}
+
+	template <size_type... Is>
+	static std::tuple<Ts *...> carve_columns(uint8_t *base, size_type elementCapacity, std::index_sequence<Is...>)
+	{
+		std::tuple<Ts *...> output;
+		((std::get<Is>(output) = reinterpret_cast<field_type<Is> *>(base), base += aligned_size(elementCapacity * sizeof(field_type<Is>), column_alignment)), ...);
+		return output;
+	}
+
+	template <size_type... Is>
+	void copy_columns(const std::tuple<Ts *...> &dest, std::index_sequence<Is...>) const
+	{
+		(memcpy(std::get<Is>(dest), std::get<Is>(columns), count * sizeof(field_type<Is>)), ...);
+	}
+
+	void grow(size_type minimumCapacity)
+	{
+		// Start at a full cache line of the smallest field
+		constexpr size_type minimum = std::max<size_type>(column_alignment / std::min({sizeof(Ts)...}), 1);
+		reserve(std::max({minimumCapacity, capacity * 2, minimum}));
+	}
+
+	const_iterator const_columns_iterator(difference_type index) const
+	{
+		return const_iterator(std::apply([](Ts *...column) { return std::tuple<const Ts *...>(column...); }, columns), index);
+	}
+
+	basic_resource<BackingT> storage;
+	std::tuple<Ts *...> columns{};
+	size_type count = 0;
+	size_type capacity = 0;
+	resource_options options;
+};
+
+/*! @brief A heap allocated struct of arrays */
+template <typename... Ts>
+using soa_vector = basic_soa_vector<heap_backing, Ts...>;
+
+/*! @brief A struct of arrays in page locked memory */
+template <typename... Ts>
+using pinned_soa_vector = basic_soa_vector<pinned_backing, Ts...>;
+
+} // namespace memory
+
+/*! @brief Structured bindings over struct of arrays elements, eg for (auto [position, velocity] : particles) */
+template <typename... Ts>
+struct std::tuple_size<memory::detail::soa_reference<Ts...>> : std::integral_constant<std::size_t, sizeof...(Ts)>
+{
+};
+
+template <std::size_t I, typename... Ts>
+struct std::tuple_element<I, memory::detail::soa_reference<Ts...>>
+{
+	using type = std::tuple_element_t<I, std::tuple<Ts...>> &;
+};
+
+/*! @brief The common reference of an element reference and its tuple is the tuple, as needed by the iterator concepts */
+template <typename... Ts, typename... Us, template <typename> typename TQual, template <typename> typename UQual>
+	requires std::same_as<std::tuple<std::remove_const_t<Ts>...>, std::tuple<Us...>>
+struct std::basic_common_reference<memory::detail::soa_reference<Ts...>, std::tuple<Us...>, TQual, UQual>
+{
+	using type = std::tuple<Us...>;
+};
+
+template <typename... Ts, typename... Us, template <typename> typename TQual, template <typename> typename UQual>
+	requires std::same_as<std::tuple<std::remove_const_t<Ts>...>, std::tuple<Us...>>
+struct std::basic_common_reference<std::tuple<Us...>, memory::detail::soa_reference<Ts...>, TQual, UQual>
+{
+	using type = std::tuple<Us...>;
+};
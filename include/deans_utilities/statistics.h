@@ -0,0 +1,257 @@
+#pragma once
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+
+#ifndef MEMORY_ENABLE_STATISTICS
+/**
+ * @brief Set to 1 to count pool, allocator and writer events, when 0 every counter compiles away
+ *
+ * This changes the layout of the pools and allocators, so it must have the same value in every translation unit
+ * of a program, eg set it through the MEMORY_UTILITIES_STATISTICS CMake option rather than per file
+ */
+#define MEMORY_ENABLE_STATISTICS 0
+#endif
+
+namespace memory
+{
+/*! @brief Check if statistics are being collected */
+constexpr bool statistics_enabled = MEMORY_ENABLE_STATISTICS != 0;
+
+/*! @brief Number of buckets in a bulk acquire histogram, bucket i counts acquires of [2^i, 2^(i+1)) regions */
+constexpr std::size_t bulk_histogram_buckets = 16;
+
+/**
+ * @brief Snapshot of a pool's counters, all zero when statistics are disabled
+ *
+ */
+struct pool_statistics
+{
+	/*! @brief Number of regions acquired */
+	uint64_t acquires = 0;
+	/*! @brief Number of regions released */
+	uint64_t releases = 0;
+	/*! @brief Number of times the pool grew */
+	uint64_t growths = 0;
+	/*! @brief Bytes of regions held by the pool, idle or in use */
+	uint64_t bytesReserved = 0;
+	/*! @brief Bytes of regions currently acquired */
+	uint64_t bytesInUse = 0;
+	/*! @brief Peak of bytesInUse */
+	uint64_t peakBytesInUse = 0;
+	/*! @brief Histogram of the number of regions per bulk acquire */
+	std::array<uint64_t, bulk_histogram_buckets> bulkAcquires = {};
+};
+
+/**
+ * @brief Snapshot of an allocator's counters, all zero when statistics are disabled
+ *
+ */
+struct allocator_statistics
+{
+	/*! @brief Number of slabs allocated */
+	uint64_t slabsAllocated = 0;
+	/*! @brief Number of slabs returned to the backing store */
+	uint64_t slabsFreed = 0;
+	/*! @brief Bytes of slabs currently allocated */
+	uint64_t bytesReserved = 0;
+	/*! @brief Peak of bytesReserved */
+	uint64_t peakBytesReserved = 0;
+};
+
+/**
+ * @brief Snapshot of the process wide writer counters, all zero when statistics are disabled
+ *
+ */
+struct writer_statistics
+{
+	/*! @brief Number of writes and reservations that failed for lack of space */
+	uint64_t failedWrites = 0;
+	/*! @brief Bytes of the failed writes */
+	uint64_t failedBytes = 0;
+	/*! @brief Number of times a chained writer moved on to a new region */
+	uint64_t overflows = 0;
+};
+
+namespace detail
+{
+#if MEMORY_ENABLE_STATISTICS
+	/**
+	 * @brief A relaxed atomic counter, safe to snapshot from any thread
+	 *
+	 */
+	struct counter
+	{
+		void add(uint64_t amount)
+		{
+			value.fetch_add(amount, std::memory_order_relaxed);
+		}
+
+		void sub(uint64_t amount)
+		{
+			value.fetch_sub(amount, std::memory_order_relaxed);
+		}
+
+		/*! @brief Raise to amount if it is larger, for peak tracking */
+		void raise(uint64_t amount)
+		{
+			uint64_t current = value.load(std::memory_order_relaxed);
+			while (current < amount && !value.compare_exchange_weak(current, amount, std::memory_order_relaxed))
+				;
+		}
+
+		uint64_t get() const
+		{
+			return value.load(std::memory_order_relaxed);
+		}
+
+		std::atomic<uint64_t> value = 0;
+	};
+
+	struct pool_counters
+	{
+		void on_acquire(std::size_t count, std::size_t resourceSize)
+		{
+			acquires.add(count);
+			bytesInUse.add(count * resourceSize);
+			peakBytesInUse.raise(bytesInUse.get());
+		}
+
+		void on_bulk_acquire(std::size_t count, std::size_t resourceSize)
+		{
+			on_acquire(count, resourceSize);
+			bulkAcquires[std::min<std::size_t>(std::bit_width(count) - 1, bulk_histogram_buckets - 1)].add(1);
+		}
+
+		void on_release(std::size_t count, std::size_t resourceSize)
+		{
+			releases.add(count);
+			bytesInUse.sub(count * resourceSize);
+		}
+
+		void on_growth(std::size_t count, std::size_t resourceSize)
+		{
+			growths.add(1);
+			bytesReserved.add(count * resourceSize);
+		}
+
+		void on_trim(std::size_t count, std::size_t resourceSize)
+		{
+			bytesReserved.sub(count * resourceSize);
+		}
+
+		pool_statistics snapshot() const
+		{
+			pool_statistics output;
+			output.acquires = acquires.get();
+			output.releases = releases.get();
+			output.growths = growths.get();
+			output.bytesReserved = bytesReserved.get();
+			output.bytesInUse = bytesInUse.get();
+			output.peakBytesInUse = peakBytesInUse.get();
+			for (std::size_t i = 0; i < bulk_histogram_buckets; ++i)
+				output.bulkAcquires[i] = bulkAcquires[i].get();
+			return output;
+		}
+
+		counter acquires;
+		counter releases;
+		counter growths;
+		counter bytesReserved;
+		counter bytesInUse;
+		counter peakBytesInUse;
+		std::array<counter, bulk_histogram_buckets> bulkAcquires;
+	};
+
+	struct allocator_counters
+	{
+		void on_allocate(std::size_t bytes)
+		{
+			slabsAllocated.add(1);
+			bytesReserved.add(bytes);
+			peakBytesReserved.raise(bytesReserved.get());
+		}
+
+		void on_free(std::size_t bytes)
+		{
+			slabsFreed.add(1);
+			bytesReserved.sub(bytes);
+		}
+
+		allocator_statistics snapshot() const
+		{
+			allocator_statistics output;
+			output.slabsAllocated = slabsAllocated.get();
+			output.slabsFreed = slabsFreed.get();
+			output.bytesReserved = bytesReserved.get();
+			output.peakBytesReserved = peakBytesReserved.get();
+			return output;
+		}
+
+		counter slabsAllocated;
+		counter slabsFreed;
+		counter bytesReserved;
+		counter peakBytesReserved;
+	};
+
+	struct writer_counters
+	{
+		static void on_failure(std::size_t amount)
+		{
+			failedWrites.add(1);
+			failedBytes.add(amount);
+		}
+
+		static void on_overflow()
+		{
+			overflows.add(1);
+		}
+
+		static writer_statistics snapshot()
+		{
+			return writer_statistics{failedWrites.get(), failedBytes.get(), overflows.get()};
+		}
+
+		static inline counter failedWrites;
+		static inline counter failedBytes;
+		static inline counter overflows;
+	};
+#else
+	// Empty counters, with [[no_unique_address]] they take no space and every call compiles away
+
+	struct pool_counters
+	{
+		void on_acquire(std::size_t, std::size_t) {}
+		void on_bulk_acquire(std::size_t, std::size_t) {}
+		void on_release(std::size_t, std::size_t) {}
+		void on_growth(std::size_t, std::size_t) {}
+		void on_trim(std::size_t, std::size_t) {}
+		pool_statistics snapshot() const { return {}; }
+	};
+
+	struct allocator_counters
+	{
+		void on_allocate(std::size_t) {}
+		void on_free(std::size_t) {}
+		allocator_statistics snapshot() const { return {}; }
+	};
+
+	struct writer_counters
+	{
+		static void on_failure(std::size_t) {}
+		static void on_overflow() {}
+		static writer_statistics snapshot() { return {}; }
+	};
+#endif
+} // namespace detail
+
+/*! @brief Get a snapshot of the process wide writer counters */
+inline writer_statistics get_writer_statistics()
+{
+	return detail::writer_counters::snapshot();
+}
+
+} // namespace memory
@@ -0,0 +1,242 @@
+#pragma once
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#include <immintrin.h>
+#define MEMORY_HAS_STREAMING_STORES 1
+#endif
+
+namespace memory
+{
+/**
+ * @brief Copies at least this large bypass the cache when written with streaming writes
+ *
+ * Below this the destination is likely to still fit in cache, so an ordinary memcpy is faster
+ */
+constexpr std::size_t streaming_threshold = 256 * 1024;
+
+namespace detail
+{
+	/*! @brief Signature of a streaming copy kernel */
+	using stream_copy_function = void (*)(uint8_t *dst, const uint8_t *src, std::size_t amount);
+
+	/*! @brief Signature of a streaming fill kernel */
+	using stream_fill_function = void (*)(uint8_t *dst, uint8_t value, std::size_t amount);
+
+#ifdef MEMORY_HAS_STREAMING_STORES
+	/**
+	 * @brief Copy the unaligned head, so the kernel can store to aligned addresses
+	 *
+	 * @return std::size_t Number of bytes copied
+	 */
+	inline std::size_t stream_copy_head(uint8_t *dst, const uint8_t *src, std::size_t amount, std::size_t alignment)
+	{
+		const std::size_t head = std::min<std::size_t>((alignment - reinterpret_cast<std::uintptr_t>(dst)) & (alignment - 1), amount);
+		memcpy(dst, src, head);
+		return head;
+	}
+
+	__attribute__((target("sse2"))) inline void stream_copy_sse2(uint8_t *dst, const uint8_t *src, std::size_t amount)
+	{
+		const std::size_t head = stream_copy_head(dst, src, amount, 16);
+		dst += head, src += head, amount -= head;
+
+		for (; amount >= 64; dst += 64, src += 64, amount -= 64)
+		{
+			const __m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i *>(src));
+			const __m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i *>(src + 16));
+			const __m128i c = _mm_loadu_si128(reinterpret_cast<const __m128i *>(src + 32));
+			const __m128i d = _mm_loadu_si128(reinterpret_cast<const __m128i *>(src + 48));
+			_mm_stream_si128(reinterpret_cast<__m128i *>(dst), a);
+			_mm_stream_si128(reinterpret_cast<__m128i *>(dst + 16), b);
+			_mm_stream_si128(reinterpret_cast<__m128i *>(dst + 32), c);
+			_mm_stream_si128(reinterpret_cast<__m128i *>(dst + 48), d);
+		}
+
+		memcpy(dst, src, amount);
+		_mm_sfence();
+	}
+
+	__attribute__((target("avx2"))) inline void stream_copy_avx2(uint8_t *dst, const uint8_t *src, std::size_t amount)
+	{
+		const std::size_t head = stream_copy_head(dst, src, amount, 32);
+		dst += head, src += head, amount -= head;
+
+		for (; amount >= 128; dst += 128, src += 128, amount -= 128)
+		{
+			const __m256i a = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(src));
+			const __m256i b = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(src + 32));
+			const __m256i c = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(src + 64));
+			const __m256i d = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(src + 96));
+			_mm256_stream_si256(reinterpret_cast<__m256i *>(dst), a);
+			_mm256_stream_si256(reinterpret_cast<__m256i *>(dst + 32), b);
+			_mm256_stream_si256(reinterpret_cast<__m256i *>(dst + 64), c);
+			_mm256_stream_si256(reinterpret_cast<__m256i *>(dst + 96), d);
+		}
+
+		memcpy(dst, src, amount);
+		_mm_sfence();
+	}
+
+	__attribute__((target("avx512f"))) inline void stream_copy_avx512(uint8_t *dst, const uint8_t *src, std::size_t amount)
+	{
+		const std::size_t head = stream_copy_head(dst, src, amount, 64);
+		dst += head, src += head, amount -= head;
+
+		for (; amount >= 256; dst += 256, src += 256, amount -= 256)
+		{
+			const __m512i a = _mm512_loadu_si512(src);
+			const __m512i b = _mm512_loadu_si512(src + 64);
+			const __m512i c = _mm512_loadu_si512(src + 128);
+			const __m512i d = _mm512_loadu_si512(src + 192);
+			_mm512_stream_si512(reinterpret_cast<__m512i *>(dst), a);
+			_mm512_stream_si512(reinterpret_cast<__m512i *>(dst + 64), b);
+			_mm512_stream_si512(reinterpret_cast<__m512i *>(dst + 128), c);
+			_mm512_stream_si512(reinterpret_cast<__m512i *>(dst + 192), d);
+		}
+
+		memcpy(dst, src, amount);
+		_mm_sfence();
+	}
+
+	/*! @brief Pick the widest streaming kernel the cpu supports */
+	inline stream_copy_function select_stream_copy()
+	{
+		__builtin_cpu_init();
+		if (__builtin_cpu_supports("avx512f"))
+			return &stream_copy_avx512;
+		if (__builtin_cpu_supports("avx2"))
+			return &stream_copy_avx2;
+		return &stream_copy_sse2;
+	}
+
+	/*! @brief Fill the unaligned head, so the kernel can store to aligned addresses */
+	inline std::size_t stream_fill_head(uint8_t *dst, uint8_t value, std::size_t amount, std::size_t alignment)
+	{
+		const std::size_t head = std::min<std::size_t>((alignment - reinterpret_cast<std::uintptr_t>(dst)) & (alignment - 1), amount);
+		memset(dst, value, head);
+		return head;
+	}
+
+	__attribute__((target("sse2"))) inline void stream_fill_sse2(uint8_t *dst, uint8_t value, std::size_t amount)
+	{
+		const std::size_t head = stream_fill_head(dst, value, amount, 16);
+		dst += head, amount -= head;
+
+		const __m128i pattern = _mm_set1_epi8(char(value));
+		for (; amount >= 64; dst += 64, amount -= 64)
+		{
+			_mm_stream_si128(reinterpret_cast<__m128i *>(dst), pattern);
+			_mm_stream_si128(reinterpret_cast<__m128i *>(dst + 16), pattern);
+			_mm_stream_si128(reinterpret_cast<__m128i *>(dst + 32), pattern);
+			_mm_stream_si128(reinterpret_cast<__m128i *>(dst + 48), pattern);
+		}
+
+		memset(dst, value, amount);
+		_mm_sfence();
+	}
+
+	__attribute__((target("avx2"))) inline void stream_fill_avx2(uint8_t *dst, uint8_t value, std::size_t amount)
+	{
+		const std::size_t head = stream_fill_head(dst, value, amount, 32);
+		dst += head, amount -= head;
+
+		const __m256i pattern = _mm256_set1_epi8(char(value));
+		for (; amount >= 128; dst += 128, amount -= 128)
+		{
+			_mm256_stream_si256(reinterpret_cast<__m256i *>(dst), pattern);
+			_mm256_stream_si256(reinterpret_cast<__m256i *>(dst + 32), pattern);
+			_mm256_stream_si256(reinterpret_cast<__m256i *>(dst + 64), pattern);
+			_mm256_stream_si256(reinterpret_cast<__m256i *>(dst + 96), pattern);
+		}
+
+		memset(dst, value, amount);
+		_mm_sfence();
+	}
+
+	__attribute__((target("avx512f"))) inline void stream_fill_avx512(uint8_t *dst, uint8_t value, std::size_t amount)
+	{
+		const std::size_t head = stream_fill_head(dst, value, amount, 64);
+		dst += head, amount -= head;
+
+		const __m512i pattern = _mm512_set1_epi32(int(0x01010101u * value));
+		for (; amount >= 256; dst += 256, amount -= 256)
+		{
+			_mm512_stream_si512(reinterpret_cast<__m512i *>(dst), pattern);
+			_mm512_stream_si512(reinterpret_cast<__m512i *>(dst + 64), pattern);
+			_mm512_stream_si512(reinterpret_cast<__m512i *>(dst + 128), pattern);
+			_mm512_stream_si512(reinterpret_cast<__m512i *>(dst + 192), pattern);
+		}
+
+		memset(dst, value, amount);
+		_mm_sfence();
+	}
+
+	/*! @brief Pick the widest streaming fill kernel the cpu supports */
+	inline stream_fill_function select_stream_fill()
+	{
+		__builtin_cpu_init();
+		if (__builtin_cpu_supports("avx512f"))
+			return &stream_fill_avx512;
+		if (__builtin_cpu_supports("avx2"))
+			return &stream_fill_avx2;
+		return &stream_fill_sse2;
+	}
+#else
+	inline void stream_copy_fallback(uint8_t *dst, const uint8_t *src, std::size_t amount)
+	{
+		memcpy(dst, src, amount);
+	}
+
+	inline stream_copy_function select_stream_copy()
+	{
+		return &stream_copy_fallback;
+	}
+
+	inline void stream_fill_fallback(uint8_t *dst, uint8_t value, std::size_t amount)
+	{
+		memset(dst, value, amount);
+	}
+
+	inline stream_fill_function select_stream_fill()
+	{
+		return &stream_fill_fallback;
+	}
+#endif
+} // namespace detail
+
+/**
+ * @brief Copy with non temporal stores, so the destination isn't pulled into cache
+ *
+ * The kernel is chosen at runtime for the widest supported instruction set, on platforms without
+ * streaming stores this is a memcpy
+ *
+ * @param dst Destination, ideally 64 byte aligned
+ * @param src Source
+ * @param amount Number of bytes to copy
+ */
+inline void stream_copy(void *dst, const void *src, std::size_t amount)
+{
+	static const detail::stream_copy_function kernel = detail::select_stream_copy();
+	kernel(static_cast<uint8_t *>(dst), static_cast<const uint8_t *>(src), amount);
+}
+
+/**
+ * @brief Fill with non temporal stores, so the destination isn't pulled into cache
+ *
+ * The kernel is chosen at runtime like stream_copy, on platforms without streaming stores this is a memset
+ *
+ * @param dst Destination, ideally 64 byte aligned
+ * @param value Byte to fill with
+ * @param amount Number of bytes to fill
+ */
+inline void stream_fill(void *dst, uint8_t value, std::size_t amount)
+{
+	static const detail::stream_fill_function kernel = detail::select_stream_fill();
+	kernel(static_cast<uint8_t *>(dst), value, amount);
+}
+
+} // namespace memory